@@ -0,0 +1,55 @@
+#ifndef EGIX_DFA_HPP
+#define EGIX_DFA_HPP
+
+#include <boost/regex.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class Dfa {
+	/*
+	 * Minimised, table-driven DFA for (final, converted) regexes without backreferences, lookarounds, anchors or other constructs that a DFA cannot express.
+	 * Only answers whether the input contains a match - which is all that a filter needs - so captures are treated as non-capturing groups.
+	 */
+  public:
+	static Dfa* compile(const char* regex,  std::string& why_not); // Returns nullptr, with the reason in why_not, if the regex is unsupported
+	bool search(const char* begin,  const char* end) const;
+	size_t n_states() const;
+	size_t n_classes() const;
+	size_t memory() const; // Bytes used by the transition table and the other lookup tables
+  private:
+	Dfa() = default;
+	uint8_t byte2class[256]; // Bytes that no part of the regex distinguishes share a class, which keeps the table small enough to stay in cache
+	std::vector<uint32_t> table; // State IDs are premultiplied by the number of classes
+	uint32_t n_cls;
+	uint32_t start;
+	uint32_t accept; // All accepting states are merged into one, as the search stops at the first match
+	char skip_bytes[3]; // Only these bytes leave the start state, if n_skip_bytes != 0
+	int n_skip_bytes;
+	bool leaves_start[256];
+};
+
+
+class Matcher {
+	/*
+	 * For filters, which only need to know whether each input contains a match of a final regex: uses the DFA where the regex allows, otherwise boost.
+	 *
+	 * Usage:
+	 *     const Matcher matcher(final_regex);
+	 *     if (matcher.search(line, line + line_sz))
+	 *         ...
+	 */
+  public:
+	explicit Matcher(const char* regex); // Throws boost::regex_error if the regex is invalid
+	bool search(const char* begin,  const char* end) const; // Same result as boost::regex_search. Like it, throws std::runtime_error if boost gives up on the input.
+	std::unique_ptr<const Dfa> dfa;
+	std::string fallback_reason;
+  private:
+	boost::basic_regex<char, boost::cpp_regex_traits<char>> regex;
+};
+
+
+#endif
@@ -8,34 +8,84 @@
 #ifndef RSCRAPER_HUB_REGEX_EDITOR_HPP
 #define RSCRAPER_HUB_REGEX_EDITOR_HPP
 
-#include <QCheckBox>
+#include <QComboBox>
 #include <QDialog>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 
 class CodeEditor;
+class Corpus;
+class GroupTable;
+struct GroupProfile;
+class OptimisationChoices;
+class PreviewPane;
+class QTimer;
+struct VarValue;
+class RegexEditorHighlighter;
+class SourceMap;
 
 
 class RegexEditor : public QDialog {
   public:
+	enum OptimisationMode {
+		dont_optimise,
+		optimise_all,
+		optimise_if_faster // Each group keeps whichever of its original and optimised forms is faster on the loaded corpus
+	};
 	RegexEditor(QWidget* parent = nullptr);
+	~RegexEditor();
   protected Q_SLOTS:
 	void test_regex();
 	void dehumanise();
 	virtual void load_file();
 	virtual void save_to_file();
+	void compile_pattern_set();
+	bool load_corpus();
+	void profile_groups();
+	void verify_optimisations();
+	void benchmark_dfa();
+	void show_metrics();
+	void build_project();
+	void live_compile();
 	void set_text(const QString& str);
 	QString get_text() const;
   protected:
 	void find_text();
+	void live_compiled(const bool ok,  const QString& error,  const QByteArray& regex,  const std::vector<QString>& group_names);
+	void groups_profiled(const std::vector<GroupProfile>& profiles,  const int revision);
+	void stop_group_profiler();
 	void ensure_buf_sized(const size_t buf_sz);
-	bool does_user_want_optimisations() const;
+	OptimisationMode optimisation_mode() const;
 	char* buf;
 	char* itr;
 	int buf_sz; // int, rather than size_t, because that is what Qt uses
-	bool to_final_format(const bool optimise,  QString& buf,  int i = 0,  int j = 1,  int last_optimised_group_indx = 0,  int var_depth = 0);
+	void preprocessor_error(const QString& text,  const QString& details);
+	bool choose_group_form(const OptimisationMode optimise,  const QString& group,  QString& replacement);
+	bool to_final_format(const QString& q,  const OptimisationMode optimise,  const bool convert_named_groups,  QString& buf,  int i = 0,  int j = 1,  int last_optimised_group_indx = 0,  int var_depth = 0);
 	void display_help() const;
-	QCheckBox* want_optimisations;
+	QComboBox* want_optimisations;
 	CodeEditor* text_editor;
+	RegexEditorHighlighter* highlighter;
+	Corpus* corpus;
+	QString include_dir; // Directory that relative word list paths are resolved against - that of the file last loaded or saved
+	SourceMap* source_map; // Maps the last to_final_format output back to its source
+	GroupTable* groups; // Capture groups of the last to_final_format output
+	OptimisationChoices* optimisation_choices;
+	PreviewPane* preview;
+	QTimer* live_compile_timer;
+	std::thread live_preprocessor; // Preprocesses for the preview, so that typing is not blocked by e.g. loading a word list
+	bool live_compile_pending; // The text was edited while live_preprocessor was running
+	std::mutex preprocess_mutex; // Held while using to_final_format and its results, as live_preprocessor may be running it
+	std::thread group_profiler; // Times each group against the corpus, which may take far longer than is acceptable to block the editor for
+	std::atomic<bool> group_profiler_cancelled;
+	bool quiet_errors; // Whether preprocessor errors should be recorded in preprocessor_error_text, rather than shown in a dialog
+	QString preprocessor_error_text;
+	const std::vector<VarValue>* predefined_vars; // Variables declared by other files, e.g. of a project, which may be used without being declared
+	std::vector<VarValue>* declared_vars; // If not null, the variables declared by to_final_format are appended to it
+	QString project_dir;
 };
 
 
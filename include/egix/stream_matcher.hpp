@@ -0,0 +1,67 @@
+#ifndef EGIX_STREAM_MATCHER_HPP
+#define EGIX_STREAM_MATCHER_HPP
+
+/*
+ * Matches a final (e.g. 'Strip'ped, 'Set' or 'Project'-built) regex against a stream that arrives in chunks, so that it need not be concatenated in memory first.
+ *
+ * The last max_carry bytes of input are carried over into the next chunk, and a match is only reported once at least max_carry bytes follow its start (or at finish()). So as long as no match, nor any attempt at one, spans more than max_carry bytes, the matches are exactly those of one boost::regex_iterator over the whole stream - including those that cross chunk boundaries. Memory use is bounded by max_carry plus the size of one chunk, however long the stream.
+ *
+ * Beyond that limit, a match that is complete is still reported, but a partial match - one that has yet to complete - is abandoned, and the search resumes at the next character.
+ *
+ * Usage:
+ *     StreamMatcher matcher(final_regex,  [](const StreamMatcher::Match& m){ ... });
+ *     while(...)
+ *         matcher.feed(chunk, chunk_sz);
+ *     matcher.finish();
+ */
+
+#include <boost/regex.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+class StreamMatcher {
+  public:
+	struct Match {
+		uint32_t reason; // Index into reasons()
+		uint64_t start; // Absolute offsets into the stream
+		uint64_t end;
+	};
+	typedef std::function<void(const Match&)> Callback;
+
+	constexpr static const size_t default_max_carry = 64 * 1024;
+
+	// Throws boost::regex_error if the regex cannot be compiled
+	StreamMatcher(const std::string& final_regex,  Callback callback,  const size_t max_carry = default_max_carry);
+
+	void feed(const char* const chunk,  const size_t chunk_sz);
+	void finish(); // Reports the matches that were waiting on more input, and resets for a new stream
+
+	const std::vector<std::string>& reasons() const {
+		return this->reason_names;
+	}
+	uint64_t n_abandoned() const {
+		// Partial matches abandoned because they outgrew max_carry
+		return this->n_abandoned_matches;
+	}
+  private:
+	void search(const bool at_end);
+
+	boost::basic_regex<char, boost::cpp_regex_traits<char>> regex;
+	std::vector<std::string> reason_names;
+	std::vector<uint32_t> group2reason; // Index 0 is the whole match
+	Callback callback;
+	const size_t max_carry;
+
+	std::string buf; // The carried-over tail of the stream, followed by the latest chunk
+	uint64_t buf_offset; // Of buf[0] in the stream
+	size_t search_from; // Index into buf. Any preceding characters are kept only as context for ^, \b and lookbehinds
+	bool after_empty_match; // The last match reported ended at search_from, and was empty
+	uint64_t n_abandoned_matches;
+};
+
+
+#endif
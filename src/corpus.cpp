@@ -0,0 +1,40 @@
+#include "corpus.hpp"
+
+#include <cstring> // for memchr
+
+
+bool Corpus::open(const QString& file_path){
+	this->records.clear();
+	if (this->file.isOpen())
+		this->file.close(); // Also unmaps
+	
+	this->file.setFileName(file_path);
+	if (!this->file.open(QIODevice::ReadOnly))
+		return false;
+	
+	const qint64 sz = this->file.size();
+	if (sz == 0)
+		return true;
+	
+	const char* itr = reinterpret_cast<const char*>(this->file.map(0, sz));
+	if (itr == nullptr)
+		return false;
+	const char* const end = itr + sz;
+	
+	while(itr != end){
+		const char* const nl = reinterpret_cast<const char*>(memchr(itr, '\n', end - itr));
+		const char* const record_end = (nl == nullptr) ? end : nl;
+		this->records.push_back({itr, record_end});
+		itr = (nl == nullptr) ? end : nl + 1;
+	}
+	
+	return true;
+}
+
+QString Corpus::error_string() const {
+	return this->file.errorString();
+}
+
+QString Corpus::file_path() const {
+	return this->file.fileName();
+}
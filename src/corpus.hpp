@@ -0,0 +1,26 @@
+#ifndef EGIX_CORPUS_HPP
+#define EGIX_CORPUS_HPP
+
+#include "corpus_record.hpp"
+
+#include <QFile>
+#include <QString>
+#include <vector>
+
+
+class Corpus {
+	/*
+	 * Sample text to match regexes against, memory-mapped rather than read, so that large corpora load instantly.
+	 * Each line is a seperate record.
+	 */
+  public:
+	bool open(const QString& file_path);
+	QString error_string() const;
+	QString file_path() const;
+	std::vector<CorpusRecord> records;
+  private:
+	QFile file;
+};
+
+
+#endif
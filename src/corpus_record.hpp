@@ -0,0 +1,11 @@
+#ifndef EGIX_CORPUS_RECORD_HPP
+#define EGIX_CORPUS_RECORD_HPP
+
+
+struct CorpusRecord {
+	const char* begin;
+	const char* end;
+};
+
+
+#endif
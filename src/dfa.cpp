@@ -0,0 +1,701 @@
+/*
+ * Regex -> AST -> Thompson NFA -> DFA (subset construction over byte classes) -> minimised DFA (Moore's algorithm).
+ * Anything the parser does not understand is reported as unsupported, so that the caller falls back to boost; the DFA never guesses.
+ */
+
+#include "egix/dfa.hpp"
+
+#include <bitset>
+#include <cctype>
+#include <cstring> // for memchr, strncmp
+#include <map>
+#include <unordered_set>
+
+
+namespace details {
+
+constexpr static const size_t max_nfa_states = 100000;
+constexpr static const size_t max_dfa_states = 10000;
+constexpr static const int max_nesting = 1000;
+
+typedef std::bitset<256> ByteSet;
+
+
+struct Node {
+	enum Type {
+		set,
+		concat,
+		alt,
+		repeat,
+		empty
+	} type;
+	explicit Node(const Type t) : type(t), min(0), max(0) {}
+	ByteSet bytes;
+	std::vector<int> children;
+	int min;
+	int max; // -1 if unbounded
+};
+
+
+class Parser {
+  public:
+	explicit Parser(const char* s) : itr(s), depth(0) {}
+	int parse();
+	std::vector<Node> nodes;
+	std::string error;
+  private:
+	const char* itr;
+	int depth;
+	int add(const Node& node);
+	int fail(const char* msg);
+	int parse_alt();
+	int parse_concat();
+	int parse_repeat();
+	int parse_atom();
+	bool parse_escape(ByteSet& bytes);
+	bool parse_class(ByteSet& bytes);
+	bool parse_int(int& n);
+};
+
+int Parser::add(const Node& node){
+	this->nodes.push_back(node);
+	return this->nodes.size() - 1;
+}
+
+int Parser::fail(const char* msg){
+	if (this->error.empty())
+		this->error = msg;
+	return -1;
+}
+
+int Parser::parse(){
+	const int root = this->parse_alt();
+	if (root < 0)
+		return -1;
+	if (*this->itr != 0)
+		return this->fail("Unbalanced ')'");
+	return root;
+}
+
+int Parser::parse_alt(){
+	if (++this->depth > max_nesting)
+		return this->fail("Too deeply nested");
+	const int first = this->parse_concat();
+	if (first < 0)
+		return -1;
+	if (*this->itr != '|'){
+		--this->depth;
+		return first;
+	}
+	Node node(Node::alt);
+	node.children.push_back(first);
+	while(*this->itr == '|'){
+		++this->itr;
+		const int next = this->parse_concat();
+		if (next < 0)
+			return -1;
+		node.children.push_back(next);
+	}
+	--this->depth;
+	return this->add(node);
+}
+
+int Parser::parse_concat(){
+	Node node(Node::concat);
+	while(*this->itr != 0  &&  *this->itr != '|'  &&  *this->itr != ')'){
+		const int child = this->parse_repeat();
+		if (child < 0)
+			return -1;
+		node.children.push_back(child);
+	}
+	if (node.children.empty())
+		return this->add(Node(Node::empty));
+	if (node.children.size() == 1)
+		return node.children[0];
+	return this->add(node);
+}
+
+bool Parser::parse_int(int& n){
+	if (!isdigit((unsigned char)*this->itr))
+		return false;
+	n = 0;
+	while(isdigit((unsigned char)*this->itr)){
+		n = 10*n + (*this->itr - '0');
+		if (n > 10000)
+			return false;
+		++this->itr;
+	}
+	return true;
+}
+
+int Parser::parse_repeat(){
+	int child = this->parse_atom();
+	if (child < 0)
+		return -1;
+	while(true){
+		int min;
+		int max;
+		switch(*this->itr){
+			case '*':
+				min = 0;
+				max = -1;
+				++this->itr;
+				break;
+			case '+':
+				min = 1;
+				max = -1;
+				++this->itr;
+				break;
+			case '?':
+				min = 0;
+				max = 1;
+				++this->itr;
+				break;
+			case '{':
+				++this->itr;
+				if (!this->parse_int(min))
+					return this->fail("Unsupported '{'");
+				max = min;
+				if (*this->itr == ','){
+					++this->itr;
+					max = -1;
+					if (*this->itr != '}'  &&  !this->parse_int(max))
+						return this->fail("Unsupported repetition");
+				}
+				if (*this->itr != '}'  ||  (max != -1  &&  max < min))
+					return this->fail("Unsupported repetition");
+				++this->itr;
+				break;
+			default:
+				return child;
+		}
+		if (*this->itr == '?')
+			// Lazy quantifiers match the same language; only the extent of the match differs, which the DFA does not report
+			++this->itr;
+		else if (*this->itr == '+')
+			return this->fail("Possessive quantifier");
+		Node node(Node::repeat);
+		node.children.push_back(child);
+		node.min = min;
+		node.max = max;
+		child = this->add(node);
+	}
+}
+
+int Parser::parse_atom(){
+	Node node(Node::set);
+	switch(*this->itr){
+		case '(': {
+			++this->itr;
+			if (*this->itr == '?'){
+				if (this->itr[1] != ':')
+					return this->fail("Unsupported group type, e.g. lookaround or inline modifier");
+				this->itr += 2;
+			}
+			const int inner = this->parse_alt();
+			if (inner < 0)
+				return -1;
+			if (*this->itr != ')')
+				return this->fail("Unbalanced '('");
+			++this->itr;
+			return inner;
+		}
+		case '[':
+			++this->itr;
+			if (!this->parse_class(node.bytes))
+				return -1;
+			return this->add(node);
+		case '.':
+			++this->itr;
+			node.bytes.set();
+			return this->add(node);
+		case '\\':
+			++this->itr;
+			if (!this->parse_escape(node.bytes))
+				return -1;
+			return this->add(node);
+		case '^':
+		case '$':
+			return this->fail("Anchor");
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+			return this->fail("Quantifier without operand");
+		default:
+			node.bytes.set((unsigned char)*this->itr);
+			++this->itr;
+			return this->add(node);
+	}
+}
+
+static
+void set_if(ByteSet& bytes,  int(*f)(int),  const bool negate){
+	for (auto c = 0;  c < 256;  ++c)
+		if ((c < 128  &&  f(c))  !=  negate)
+			bytes.set(c);
+}
+
+static
+int is_word(int c){
+	return isalnum(c)  ||  c == '_';
+}
+
+static
+int is_regex_space(int c){
+	// Same as boost in the C locale
+	return c == ' '  ||  (c >= '\t'  &&  c <= '\r');
+}
+
+bool Parser::parse_escape(ByteSet& bytes){
+	const char c = *this->itr;
+	if (c == 0){
+		this->fail("Trailing backslash");
+		return false;
+	}
+	++this->itr;
+	switch(c){
+		case 'd': set_if(bytes, isdigit, false); return true;
+		case 'D': set_if(bytes, isdigit, true); return true;
+		case 'w': set_if(bytes, is_word, false); return true;
+		case 'W': set_if(bytes, is_word, true); return true;
+		case 's': set_if(bytes, is_regex_space, false); return true;
+		case 'S': set_if(bytes, is_regex_space, true); return true;
+		case 'n': bytes.set('\n'); return true;
+		case 't': bytes.set('\t'); return true;
+		case 'r': bytes.set('\r'); return true;
+		case 'v': bytes.set('\v'); return true;
+		case 'f': bytes.set('\f'); return true;
+		case 'a': bytes.set('\a'); return true;
+		case 'e': bytes.set(0x1b); return true;
+		case 'x': {
+			int n = 0;
+			for (auto k = 0;  k < 2;  ++k){
+				const unsigned char h = *this->itr;
+				if (!isxdigit(h)){
+					this->fail("Unsupported hex escape");
+					return false;
+				}
+				n = 16*n + (isdigit(h) ? h - '0' : tolower(h) - 'a' + 10);
+				++this->itr;
+			}
+			bytes.set(n);
+			return true;
+		}
+	}
+	if (isalnum((unsigned char)c)){
+		// Backreferences, word boundaries, \A, \z, \Q...\E, unicode properties, etc.
+		this->fail("Unsupported escape");
+		return false;
+	}
+	if (c == '<'  ||  c == '>'  ||  c == '`'  ||  c == '\''){
+		// Anchors in boost's perl syntax: the start and end of a word, and of the buffer
+		this->fail("Anchor");
+		return false;
+	}
+	bytes.set((unsigned char)c);
+	return true;
+}
+
+bool Parser::parse_class(ByteSet& bytes){
+	const bool negate = (*this->itr == '^');
+	if (negate)
+		++this->itr;
+	bool first = true;
+	while(true){
+		const char c = *this->itr;
+		if (c == 0){
+			this->fail("Unbalanced '['");
+			return false;
+		}
+		if (c == ']'  &&  !first)
+			break;
+		first = false;
+
+		if (c == '['  &&  (this->itr[1] == '.'  ||  this->itr[1] == '=')){
+			// [.a.] is a collating element and [=a=] an equivalence class, which depend on the locale
+			this->fail("Unsupported collating element or equivalence class");
+			return false;
+		}
+		if (c == '['  &&  this->itr[1] == ':'){
+			constexpr static const char* names[] = {"alpha:]", "digit:]", "alnum:]", "space:]", "upper:]", "lower:]", "punct:]", "xdigit:]"};
+			static int(* const fns[])(int) = {isalpha, isdigit, isalnum, is_regex_space, isupper, islower, ispunct, isxdigit};
+			size_t k = 0;
+			for (;  k < sizeof(fns)/sizeof(fns[0]);  ++k)
+				if (strncmp(this->itr + 2,  names[k],  strlen(names[k])) == 0)
+					break;
+			if (k == sizeof(fns)/sizeof(fns[0])){
+				this->fail("Unsupported character class");
+				return false;
+			}
+			this->itr += 2 + strlen(names[k]);
+			set_if(bytes, fns[k], false);
+			continue;
+		}
+
+		ByteSet item;
+		if (c == '\\'){
+			++this->itr;
+			if (!this->parse_escape(item))
+				return false;
+		} else {
+			item.set((unsigned char)c);
+			++this->itr;
+		}
+
+		if (*this->itr == '-'  &&  this->itr[1] != ']'  &&  this->itr[1] != 0){
+			if (item.count() != 1  ||  this->itr[1] == '\\'  ||  this->itr[1] == '['){
+				this->fail("Unsupported range");
+				return false;
+			}
+			int lo = 0;
+			while(!item.test(lo))
+				++lo;
+			const int hi = (unsigned char)this->itr[1];
+			if (hi < lo){
+				this->fail("Invalid range");
+				return false;
+			}
+			for (auto b = lo;  b <= hi;  ++b)
+				item.set(b);
+			this->itr += 2;
+		}
+		bytes |= item;
+	}
+	++this->itr; // Skip ]
+	if (negate)
+		bytes.flip();
+	return true;
+}
+
+
+struct NfaState {
+	std::vector<int> eps;
+	int set; // Index into Nfa::sets, or -1 if this state has no byte transition
+	int next;
+};
+
+
+class Nfa {
+  public:
+	Nfa(const std::vector<Node>& _nodes) : nodes(_nodes) {}
+	bool build(const int root);
+	std::vector<NfaState> states;
+	std::vector<ByteSet> sets;
+	int start;
+	int accept;
+  private:
+	const std::vector<Node>& nodes;
+	int new_state();
+	bool compile(const int node,  int& in,  int& out);
+};
+
+int Nfa::new_state(){
+	this->states.push_back({{}, -1, -1});
+	return this->states.size() - 1;
+}
+
+bool Nfa::compile(const int node_indx,  int& in,  int& out){
+	if (this->states.size() > max_nfa_states)
+		return false;
+	const Node& node = this->nodes[node_indx];
+	in  = this->new_state();
+	out = this->new_state();
+	switch(node.type){
+		case Node::set:
+			this->states[in].set  = this->sets.size();
+			this->states[in].next = out;
+			this->sets.push_back(node.bytes);
+			return true;
+		case Node::empty:
+			this->states[in].eps.push_back(out);
+			return true;
+		case Node::concat: {
+			int prev = in;
+			for (const int child : node.children){
+				int a, b;
+				if (!this->compile(child, a, b))
+					return false;
+				this->states[prev].eps.push_back(a);
+				prev = b;
+			}
+			this->states[prev].eps.push_back(out);
+			return true;
+		}
+		case Node::alt:
+			for (const int child : node.children){
+				int a, b;
+				if (!this->compile(child, a, b))
+					return false;
+				this->states[in].eps.push_back(a);
+				this->states[b].eps.push_back(out);
+			}
+			return true;
+		case Node::repeat: {
+			// Counted repetitions are expanded into copies of the repeated node
+			int prev = in;
+			for (auto n = 0;  n < node.min;  ++n){
+				int a, b;
+				if (!this->compile(node.children[0], a, b))
+					return false;
+				this->states[prev].eps.push_back(a);
+				prev = b;
+			}
+			if (node.max == -1){
+				int a, b;
+				if (!this->compile(node.children[0], a, b))
+					return false;
+				this->states[prev].eps.push_back(a);
+				this->states[b].eps.push_back(prev);
+			} else {
+				for (auto n = node.min;  n < node.max;  ++n){
+					int a, b;
+					if (!this->compile(node.children[0], a, b))
+						return false;
+					this->states[prev].eps.push_back(a);
+					this->states[prev].eps.push_back(out);
+					prev = b;
+				}
+			}
+			this->states[prev].eps.push_back(out);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Nfa::build(const int root){
+	return this->compile(root,  this->start,  this->accept);
+}
+
+
+static
+void add_closure(const Nfa& nfa,  const int state,  std::vector<char>& seen,  std::vector<int>& closure){
+	std::vector<int> stack = {state};
+	while(!stack.empty()){
+		const int s = stack.back();
+		stack.pop_back();
+		if (seen[s])
+			continue;
+		seen[s] = true;
+		closure.push_back(s);
+		for (const int t : nfa.states[s].eps)
+			stack.push_back(t);
+	}
+}
+
+} // namespace details
+
+
+Dfa* Dfa::compile(const char* regex,  std::string& why_not){
+	using namespace details;
+
+	Parser parser(regex);
+	const int root = parser.parse();
+	if (root < 0){
+		why_not = parser.error;
+		return nullptr;
+	}
+
+	Nfa nfa(parser.nodes);
+	if (!nfa.build(root)){
+		why_not = "Too many NFA states";
+		return nullptr;
+	}
+
+	Dfa* const dfa = new Dfa;
+
+	// Byte classes: bytes are in the same class iff every set in the NFA either contains both or neither
+	{
+		std::unordered_set<ByteSet> distinct_sets(nfa.sets.begin(), nfa.sets.end());
+		int cls[256] = {};
+		int n_cls = 1;
+		for (const ByteSet& set : distinct_sets){
+			std::vector<int> split(2 * n_cls,  -1); // (old class, is in set) -> new class
+			int n_split = 0;
+			for (auto b = 0;  b < 256;  ++b){
+				int& c = split[2 * cls[b] + set.test(b)];
+				if (c == -1)
+					c = n_split++;
+				cls[b] = c;
+			}
+			n_cls = n_split;
+		}
+		for (auto b = 0;  b < 256;  ++b)
+			dfa->byte2class[b] = cls[b];
+		dfa->n_cls = n_cls;
+	}
+	std::vector<int> class_representative(dfa->n_cls);
+	for (auto b = 255;  b >= 0;  --b)
+		class_representative[dfa->byte2class[b]] = b;
+
+	// Subset construction. Every DFA state includes the closure of the start state, so that the search is unanchored.
+	std::vector<char> seen(nfa.states.size(), false);
+	std::vector<int> start_closure;
+	add_closure(nfa, nfa.start, seen, start_closure);
+	for (const int s : start_closure)
+		seen[s] = false;
+
+	std::map<std::vector<int>, uint32_t> subset2id;
+	std::vector<std::vector<int>> subsets;
+	std::vector<char> accepting;
+	std::vector<uint32_t> table; // Unminimised, not premultiplied
+
+	auto intern = [&](std::vector<int>& subset) -> uint32_t {
+		std::sort(subset.begin(), subset.end());
+		const auto it = subset2id.find(subset);
+		if (it != subset2id.end())
+			return it->second;
+		const uint32_t id = subsets.size();
+		subset2id.emplace(subset, id);
+		accepting.push_back(std::binary_search(subset.begin(), subset.end(), nfa.accept));
+		subsets.push_back(subset);
+		return id;
+	};
+
+	{
+		std::vector<int> s0 = start_closure;
+		intern(s0);
+	}
+	for (size_t id = 0;  id < subsets.size();  ++id){
+		if (subsets.size() > max_dfa_states){
+			why_not = "Too many DFA states";
+			delete dfa;
+			return nullptr;
+		}
+		table.resize((id + 1) * dfa->n_cls);
+		if (accepting[id]){
+			// Absorbing, as the search stops at the first match
+			for (uint32_t c = 0;  c < dfa->n_cls;  ++c)
+				table[id * dfa->n_cls + c] = id;
+			continue;
+		}
+		for (uint32_t c = 0;  c < dfa->n_cls;  ++c){
+			const int b = class_representative[c];
+			std::vector<int> next;
+			for (const int s : start_closure)
+				add_closure(nfa, s, seen, next);
+			for (const int s : subsets[id]){
+				const NfaState& state = nfa.states[s];
+				if (state.set != -1  &&  nfa.sets[state.set].test(b))
+					add_closure(nfa, state.next, seen, next);
+			}
+			for (const int s : next)
+				seen[s] = false;
+			table[id * dfa->n_cls + c] = intern(next);
+		}
+	}
+
+	// Moore minimisation: refine the accepting/non-accepting partition until no block can be split by any class
+	const size_t n = subsets.size();
+	std::vector<uint32_t> block(n);
+	size_t n_blocks = 0;
+	for (size_t s = 0;  s < n;  ++s)
+		block[s] = accepting[s];
+	while(true){
+		std::map<std::vector<uint32_t>, uint32_t> signature2block;
+		std::vector<uint32_t> new_block(n);
+		for (size_t s = 0;  s < n;  ++s){
+			std::vector<uint32_t> signature(1 + dfa->n_cls);
+			signature[0] = block[s];
+			for (uint32_t c = 0;  c < dfa->n_cls;  ++c)
+				signature[1 + c] = block[table[s * dfa->n_cls + c]];
+			new_block[s] = signature2block.emplace(signature, signature2block.size()).first->second;
+		}
+		block.swap(new_block);
+		if (signature2block.size() == n_blocks)
+			break;
+		n_blocks = signature2block.size();
+	}
+
+	dfa->table.resize(n_blocks * dfa->n_cls);
+	for (size_t s = 0;  s < n;  ++s)
+		for (uint32_t c = 0;  c < dfa->n_cls;  ++c)
+			dfa->table[block[s] * dfa->n_cls + c] = block[table[s * dfa->n_cls + c]] * dfa->n_cls;
+	dfa->start  = block[0] * dfa->n_cls;
+	dfa->accept = dfa->start;
+	for (size_t s = 0;  s < n;  ++s)
+		if (accepting[s])
+			dfa->accept = block[s] * dfa->n_cls;
+	if (dfa->accept == dfa->start  &&  !accepting[0])
+		dfa->accept = (uint32_t)-1; // No accepting state is reachable
+
+	// If only a few bytes can leave the start state, the scan loop can skip straight to them with memchr - which libc vectorises
+	dfa->n_skip_bytes = 0;
+	for (auto b = 0;  b < 256;  ++b)
+		dfa->leaves_start[b] = (dfa->table[dfa->start + dfa->byte2class[b]] != dfa->start);
+	for (auto b = 0;  b < 256;  ++b){
+		if (!dfa->leaves_start[b])
+			continue;
+		if (dfa->n_skip_bytes == 3){
+			dfa->n_skip_bytes = 0;
+			break;
+		}
+		dfa->skip_bytes[dfa->n_skip_bytes++] = (char)b;
+	}
+
+	return dfa;
+}
+
+bool Dfa::search(const char* begin,  const char* end) const {
+	const uint32_t start_state  = this->start;
+	const uint32_t accept_state = this->accept;
+	if (start_state == accept_state)
+		return true;
+	const uint32_t* const tbl = this->table.data();
+	const uint8_t* const cls = this->byte2class;
+	const char* next_skip_byte[3]; // Cached memchr results, so that each byte's occurrences are only scanned once
+	bool scanned[3] = {false, false, false};
+	uint32_t s = start_state;
+	const char* p = begin;
+	while(p != end){
+		if (s == start_state){
+			if (this->n_skip_bytes != 0){
+				const char* nearest = end;
+				for (auto k = 0;  k < this->n_skip_bytes;  ++k){
+					if (!scanned[k]  ||  (next_skip_byte[k] != nullptr  &&  next_skip_byte[k] < p)){
+						next_skip_byte[k] = reinterpret_cast<const char*>(memchr(p,  this->skip_bytes[k],  end - p));
+						scanned[k] = true;
+					}
+					if (next_skip_byte[k] != nullptr  &&  next_skip_byte[k] < nearest)
+						nearest = next_skip_byte[k];
+				}
+				p = nearest;
+			} else {
+				while(p != end  &&  !this->leaves_start[(unsigned char)*p])
+					++p;
+			}
+			if (p == end)
+				return false;
+		}
+		s = tbl[s + cls[(unsigned char)*p++]];
+		if (s == accept_state)
+			return true;
+	}
+	return false;
+}
+
+size_t Dfa::n_states() const {
+	return this->table.size() / this->n_cls;
+}
+
+size_t Dfa::n_classes() const {
+	return this->n_cls;
+}
+
+size_t Dfa::memory() const {
+	return this->table.size() * sizeof(uint32_t) + sizeof(this->byte2class) + sizeof(this->leaves_start) + sizeof(this->skip_bytes);
+}
+
+
+Matcher::Matcher(const char* _regex)
+: regex(_regex,  boost::regex::perl) // Constructed first, so that invalid regexes are rejected by boost rather than the DFA parser
+{
+	this->dfa.reset(Dfa::compile(_regex,  this->fallback_reason));
+}
+
+bool Matcher::search(const char* begin,  const char* end) const {
+	if (this->dfa != nullptr)
+		return this->dfa->search(begin, end);
+	return boost::regex_search(begin,  end,  this->regex);
+}
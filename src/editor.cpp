@@ -11,10 +11,22 @@
 #include "sql_name_dialog.hpp"
 #include "regopt.hpp"
 #include "msgbox.hpp"
+#include "pattern_set.hpp"
+#include "group_table.hpp"
+#include "corpus.hpp"
+#include "group_profile.hpp"
+#include "regex_diff.hpp"
+#include "source_map.hpp"
+#include "egix/dfa.hpp"
+#include "word_list.hpp"
+#include "trace.hpp"
+#include "optimisation_choice.hpp"
+#include "preview_pane.hpp"
+#include "regex_metrics.hpp"
+#include "project.hpp"
 #include "3rdparty/codeeditor.hpp"
 
 #include <compsky/mysql/query.hpp>
-#include <compsky/regex/named_groups.hpp>
 
 #include <boost/regex.hpp>
 
@@ -28,6 +40,21 @@
 #include <QVBoxLayout>
 #include <QFileDialog>
 #include <QTextStream>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include <QHash>
+#include <QFileInfo>
+#include <QTimer>
+
+#include <atomic>
+#include <thread>
+
+#include <algorithm> // for std::find
+#include <chrono>
+#include <stdexcept>
+#include <unordered_set>
 
 
 
@@ -38,6 +65,7 @@ namespace filter_comment_body {
 static const QString help_text = 
 	"Supports boost::regex Perl syntax, with Python named groups (?P<name>).\n"
 	"The group syntax is more flexible than Python's - you can use whatever characters you please, save for '&' and '<', and can use the same group name for multiple groups.\n"
+	"A group name beginning with '&' marks the group's contents to be recorded, rather than only its occurances counted.\n"
 	"Group names are indicated with bold blue text.\n"
 	"\n"
 	"The first spaces and tabs of each line are ignored, except if the newline was escaped.\n"
@@ -55,6 +83,24 @@ static const QString help_text =
 	"These encompass strings which can then be copy-pasted using an unescaped ${VARNAME}, substituting VARNAME for the exact name of the variable. This will copy everything (aside from the variable name) within the curly braces - for instance, {?P<foobar>hello}${foobar} would result in the string 'hellohello' appearing in the final regex.\n"
 	"Such variables can also be declared seperately to the regex file in the 'Vars' menu.\n"
 	"Variable declarations must not share names with each other.\n"
+	"\n"
+	"${@path/to/words.txt} includes a word list - one literal word per line - as a single trie-compressed group, without the words ever being loaded into the editor. Relative paths are relative to the directory of the file last loaded or saved. The compressed group is cached by the file's hash, and is never passed to regopt.pl.\n"
+	"\n"
+	"'Optimise if faster' benchmarks the original and optimised forms of each group against the loaded corpus, and keeps the faster. The choices and timings are recorded in optimisation_choices.tsv in the application data directory, and reused while the group and corpus are unchanged. Without a corpus, every group is optimised.\n"
+	"\n"
+	"Once a corpus is loaded, the pane below the buttons previews the first matches of the (unoptimised) regex on it, updating shortly after each edit. Preprocessor and regex errors are shown there rather than in dialogs. Where the regex can be compiled to a DFA (see 'DFA'), the DFA skips the records without a match, and boost only finds the groups of those with one.\n"
+	"\n"
+	"'Profile' times each capture group in isolation against the lines of the loaded corpus. The results are shown in a sortable table, and as a heat-map over the source: the redder the line, the slower its innermost group. Profiling runs in the background, and the heat-map is cleared as soon as the source is edited, as its lines would no longer correspond to the groups. A group that exceeds boost's complexity limit is reported as having failed.\n"
+	"\n"
+	"'Verify' preprocesses the source both with and without optimisation, and checks that the two regexes agree - on whether they match, and on the spans of their groups - on strings generated by exrex, mutations of those strings, previously failing strings, and the loaded corpus. Match times of both are recorded in verify_log.tsv in the application data directory. The most recent 1000 failing strings are kept in verify_regressions.txt.\n"
+	"\n"
+	"'DFA' reports whether the regex can be compiled to a DFA - i.e. it uses no backreferences, lookarounds, anchors or other unsupported constructs - and benchmarks it against boost on the loaded corpus.\n"
+	"\n"
+	"'Metrics' reports the size and complexity of the regex, both unoptimised and optimised: its length, groups, atoms, alternatives, repeats and nested repeats (such as (a+)*, the usual cause of catastrophic backtracking); the heap allocated by compiling it (measured, where the platform allows); the DFA's size if there is one; a heuristic cost, weighting those counts, that is only meaningful relative to that of another regex; and, if a corpus is loaded, the measured matching time, which is what the heuristic merely guesses at. Each run is appended to metrics.jsonl in the application data directory, to track these across versions.\n"
+	"\n"
+	"'Project' builds every regex source (*.re, *.regex and *.egix files) in a directory. A source may use ${VAR} without declaring VAR, if another source of the project declares it. Each source's final regex is written to the same relative path under .egix-build. The declarations and uses of each source are indexed in .egix-index, and only the sources that changed since the last build, that include a ${@word list} that changed, or that use the variables of a rebuilt source, are rebuilt. Changing the optimisation mode, or upgrading egix, rebuilds every source. The outputs of deleted sources are removed.\n"
+	"\n"
+	"'Set' combines several regex files into a single alternation, to be searched in one pass. Each capture group is mapped back to the file it originated from. The first file to match wins: where several files match at the same position, only the earliest in the set is reported, even if a later one matches more; and no match is reported that starts within another. Files whose matches may overlap, and must all be found, should not share a set.\n"
 ;
 
 
@@ -76,6 +122,12 @@ RegexEditor::RegexEditor(QWidget* parent) : QDialog(parent) {
 	if(unlikely(this->buf == nullptr))
 		exit(4096);
 	this->itr = buf;
+	this->corpus = nullptr;
+	this->source_map = new SourceMap;
+	this->groups = new GroupTable;
+	const QString data_dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+	QDir().mkpath(data_dir);
+	this->optimisation_choices = new OptimisationChoices(data_dir + "/optimisation_choices.tsv");
 	
 	QVBoxLayout* l = new QVBoxLayout;
 	
@@ -89,7 +141,7 @@ RegexEditor::RegexEditor(QWidget* parent) : QDialog(parent) {
 	this->text_editor->setTabStopWidth(metrics.width("    "));
 
 	l->addWidget(this->text_editor);
-	new RegexEditorHighlighter(this->text_editor->document());
+	this->highlighter = new RegexEditorHighlighter(this->text_editor->document());
 
 	{
 	QHBoxLayout* hbox = new QHBoxLayout;
@@ -106,7 +158,8 @@ RegexEditor::RegexEditor(QWidget* parent) : QDialog(parent) {
 	hbox->addWidget(btn);
 	}
 
-	this->want_optimisations = new QCheckBox("Optimise", this);
+	this->want_optimisations = new QComboBox(this);
+	this->want_optimisations->addItems({"No optimisation", "Optimise", "Optimise if faster"}); // In the order of OptimisationMode
 	l->addWidget(this->want_optimisations);
 
 	{
@@ -133,6 +186,18 @@ RegexEditor::RegexEditor(QWidget* parent) : QDialog(parent) {
 	hbox->addWidget(btn);
 	}
 	
+	{
+	QPushButton* btn = new QPushButton("Set", this);
+	connect(btn, &QPushButton::clicked, this, &RegexEditor::compile_pattern_set);
+	hbox->addWidget(btn);
+	}
+	
+	{
+	QPushButton* btn = new QPushButton("Project", this);
+	connect(btn, &QPushButton::clicked, this, &RegexEditor::build_project);
+	hbox->addWidget(btn);
+	}
+	
 
 	l->addLayout(hbox);
 	}
@@ -144,12 +209,65 @@ RegexEditor::RegexEditor(QWidget* parent) : QDialog(parent) {
 			connect(btn, &QPushButton::clicked, this->text_editor, &CodeEditor::jump_to_partner);
 			hbox->addWidget(btn);
 		}
+		{
+			QPushButton* btn = new QPushButton("Corpus", this);
+			connect(btn, &QPushButton::clicked, this, &RegexEditor::load_corpus);
+			hbox->addWidget(btn);
+		}
+		{
+			QPushButton* btn = new QPushButton("Profile", this);
+			connect(btn, &QPushButton::clicked, this, &RegexEditor::profile_groups);
+			hbox->addWidget(btn);
+		}
+		{
+			QPushButton* btn = new QPushButton("Verify", this);
+			connect(btn, &QPushButton::clicked, this, &RegexEditor::verify_optimisations);
+			hbox->addWidget(btn);
+		}
+		{
+			QPushButton* btn = new QPushButton("DFA", this);
+			connect(btn, &QPushButton::clicked, this, &RegexEditor::benchmark_dfa);
+			hbox->addWidget(btn);
+		}
+		{
+			QPushButton* btn = new QPushButton("Metrics", this);
+			connect(btn, &QPushButton::clicked, this, &RegexEditor::show_metrics);
+			hbox->addWidget(btn);
+		}
 		l->addLayout(hbox);
 	}
 	
+	this->preview = new PreviewPane(this);
+	l->addWidget(this->preview);
+	
+	this->quiet_errors = false;
+	this->predefined_vars = nullptr;
+	this->declared_vars = nullptr;
+	this->live_compile_pending = false;
+	this->group_profiler_cancelled = false;
+	this->live_compile_timer = new QTimer(this);
+	this->live_compile_timer->setSingleShot(true);
+	this->live_compile_timer->setInterval(300); // Debounced, so that a burst of keystrokes triggers a single compile
+	connect(this->live_compile_timer, &QTimer::timeout, this, &RegexEditor::live_compile);
+	connect(this->text_editor, &CodeEditor::textChanged, this->live_compile_timer, static_cast<void (QTimer::*)()>(&QTimer::start));
+	
 	this->setLayout(l);
 }
 
+
+RegexEditor::~RegexEditor(){
+	this->stop_group_profiler();
+	if (this->live_preprocessor.joinable())
+		this->live_preprocessor.join();
+	// The preview pane is only deleted after this, as a child widget, so its runs must stop reading the corpus first
+	this->preview->set_corpus(nullptr);
+	delete this->corpus;
+	delete this->source_map;
+	delete this->groups;
+	delete this->optimisation_choices;
+	free(this->buf);
+}
+
 void RegexEditor::find_text(){
 	SQLNameDialog* dialog = new SQLNameDialog("Find"); // TODO: Have PatternNameDialog, perhaps which SQLNameDialog inherits. SQLNameDialog also needs a case-insensitive option.
 	const int rc = dialog->exec();
@@ -194,26 +312,170 @@ void RegexEditor::display_help() const{
 
 
 
-int get_line_n(const QString& s,  int end){
-	int n = 1;
-	for (auto i = 0;  i <= end;  ++i)
-		if (s.at(i) == QChar('\n'))
-			++n;
-	return n;
+void RegexEditor::preprocessor_error(const QString& text,  const QString& details){
+	// Live compiles and project builds report errors themselves - in the preview pane, or alongside the file name - rather than in a dialog
+	if (this->quiet_errors){
+		this->preprocessor_error_text = text;
+		return;
+	}
+	MsgBox* msgbox = new MsgBox(0,  text,  details);
+	msgbox->exec();
+	delete msgbox;
+}
+
+bool RegexEditor::choose_group_form(const OptimisationMode optimise,  const QString& group,  QString& replacement){
+	// Returns false if the group should be left in its original form
+	if (optimise == optimise_all  ||  this->corpus == nullptr){
+		QString s = group;
+		optimise_regex(s, replacement);
+		return true;
+	}
+	const OptimisationChoice* choice = this->optimisation_choices->find(group, *this->corpus);
+	if (choice == nullptr){
+		EGIX_TRACE_SCOPE("optimisation benchmark");
+		OptimisationChoice measured;
+		QString s = group;
+		optimise_regex(s, measured.optimised);
+		benchmark_group_forms(group,  *this->corpus,  measured);
+		choice = this->optimisation_choices->insert(group,  *this->corpus,  measured);
+	} else {
+		trace::count("optimisation choices reused");
+	}
+	if (!choice->use_optimised)
+		return false;
+	replacement = choice->optimised;
+	return true;
 }
 
-bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  int j,  int last_optimised_group_indx,  int var_depth){ // Use seperate buffer to avoid overwriting text_editor contents
+bool RegexEditor::to_final_format(const QString& q,  const OptimisationMode optimise,  const bool convert_named_groups,  QString& buf,  int i,  int j,  int last_optimised_group_indx,  int var_depth){ // Use seperate buffer to avoid overwriting text_editor contents
 	// WARNING: Does not currently support special encodings, i.e. non-ASCII characters are likely to be mangled.
 	// TODO: Add utf8 support.
-	const QString q = this->text_editor->toPlainText();
 	
 	int group_start = 0;
 	int group_start_offset;
 	static std::vector<QStringRef> var_names;
 	static std::vector<QStringRef> var_values;
 	static std::vector<int> var_starts;
+	static std::vector<int> group_stack; // Group table index of each open bracket, or -1 if it is not a capture group
+	static bool regex_escaped = false; // Whether the next emitted character is escaped in the final regex
+	static int regex_set_len = -1; // Number of characters emitted within the current [...] set, or -1 if outside of one
+	static bool regex_set_negated;
 	bool on_line_where_group_was_declared = false;
 	bool do_not_optimise_this_group; // Initialised at the start of every group
+	
+	const trace::Scope trace_scope((i == 0) ? "preprocess" : nullptr); // Optimised groups recurse, and are timed as part of the outermost call
+	if (i == 0)
+		this->groups->clear();
+	
+	// The group table is built as the regex is emitted, which requires knowing whether each emitted bracket is regex syntax
+	auto emit_char = [&](const QChar ch,  const SourceSpan src){
+		if (regex_escaped){
+			regex_escaped = false;
+			if (regex_set_len != -1)
+				++regex_set_len;
+		} else if (ch == QChar('\\')){
+			regex_escaped = true;
+		} else if (regex_set_len != -1){
+			if (ch == QChar('^')  &&  regex_set_len == 0  &&  !regex_set_negated)
+				regex_set_negated = true;
+			else if (ch == QChar(']')  &&  regex_set_len != 0)
+				regex_set_len = -1;
+			else
+				++regex_set_len;
+		} else if (ch == QChar('[')){
+			regex_set_len = 0;
+			regex_set_negated = false;
+		} else if (ch == QChar(')')  &&  !group_stack.empty()){
+			const int g = group_stack.back();
+			group_stack.pop_back();
+			if (g != -1)
+				this->groups->close[g] = j;
+		}
+		if (src.end == src.start + 1)
+			this->source_map->add(j, src.start);
+		else
+			this->source_map->add_span(j,  1,  src);
+		buf[j++] = ch;
+	};
+	auto opens_group = [&](const QChar ch){
+		return (ch == QChar('('))  &&  !regex_escaped  &&  (regex_set_len == -1);
+	};
+	auto emit_open_bracket = [&](const QString& text,  const SourceSpan src,  int k) -> int {
+		// k is the offset into text following the bracket. Returns the offset to continue from. text is either the source, or substituted text that is already in the final format.
+		const bool from_source = (&text == &q);
+		auto emit_raw = [&](const int from,  const int to){
+			// Group names may contain any characters, so must not affect the lexical state
+			for (int n = from;  n < to  &&  n < text.size();  ++n){
+				if (from_source)
+					this->source_map->add(j, n);
+				else
+					this->source_map->add_span(j, 1, src);
+				buf[j++] = text.at(n);
+			}
+		};
+		const int open = j;
+		emit_char(QChar('('), src);
+		if (k < text.size()  &&  text.at(k) == QChar('?')){
+			const QStringRef after(&text,  k + 1,  std::min(2,  text.size() - (k + 1)));
+			if ((after.startsWith(QChar('<'))  &&  !after.startsWith(QLatin1String("<="))  &&  !after.startsWith(QLatin1String("<!")))  ||  after.startsWith(QChar('\''))){
+				// (?<name>...) or (?'name'...): captures, as in boost, but does not name a reason. The name is kept for boost's named backreferences.
+				const QChar terminator = (after.at(0) == QChar('<')) ? QChar('>') : QChar('\'');
+				int name_end = k + 2;
+				while(name_end < text.size()  &&  text.at(name_end) != terminator)
+					++name_end;
+				emit_raw(k,  name_end + 1);
+				group_stack.push_back(this->groups->add(0,  false,  open,  j));
+				trace::count("capture groups");
+				return name_end + 1;
+			}
+			if (!after.startsWith(QLatin1String("P<"))){
+				group_stack.push_back(-1); // Non-capturing group or lookaround
+				return k;
+			}
+			const int name_start = k + 3;
+			int name_end = name_start;
+			while(name_end < text.size()  &&  text.at(name_end) != QChar('>'))
+				++name_end;
+			if (!(convert_named_groups  &&  from_source))
+				emit_raw(k,  name_end + 1);
+			const QStringRef name(&text,  name_start,  name_end - name_start);
+			const bool record_contents = name.startsWith(QChar('&'));
+			const int reason = this->groups->intern(((record_contents) ? name.mid(1) : name).toString());
+			group_stack.push_back(this->groups->add(reason,  record_contents,  open,  j));
+			trace::count("capture groups");
+			return name_end + 1;
+		}
+		group_stack.push_back(this->groups->add(0,  false,  open,  j));
+		trace::count("capture groups");
+		return k;
+	};
+	auto emit_substituted = [&](const QString& text,  const GroupTable& text_groups,  const SourceSpan src){
+		// Emits text that is already in the final format - a variable's value or a word list - through the same lexer as the source, so that the brackets it opens and closes balance against those around it, and so that its brackets are groups only if they are in this context too. text_groups are its groups, from which the reasons of groups whose names were already converted are taken.
+		size_t g = 0;
+		for (int p = 0;  p < text.size();  ){
+			const QChar ch = text.at(p);
+			if (!opens_group(ch)){
+				emit_char(ch, src);
+				++p;
+				continue;
+			}
+			while(g < text_groups.size()  &&  text_groups.open[g] < p)
+				++g;
+			if (g < text_groups.size()  &&  text_groups.open[g] == p){
+				const int open = j;
+				emit_char(ch, src);
+				for (++p;  p < text_groups.body_start[g];  ++p){
+					this->source_map->add_span(j, 1, src);
+					buf[j++] = text.at(p);
+				}
+				group_stack.push_back(this->groups->add(this->groups->reason_id(text_groups.reasons,  text_groups.reason[g]),  text_groups.record_contents[g],  open,  j));
+				trace::count("capture groups");
+				continue;
+			}
+			p = emit_open_bracket(text,  src,  p + 1);
+		}
+	};
+	
 	for(;  i < q.size();  ){
 		QChar c = q.at(i);
 		if (c == QChar('\\')){
@@ -236,17 +498,18 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 			else if (ch == QChar(')'));
 			else {
 				constexpr static const int ctx = 10;
-				MsgBox* msgbox = new MsgBox(
-					0,  
-					"Unrecognised escape sequence: \\" + QString(ch) + " at line " + QString::number(get_line_n(q, i)),
+				this->preprocessor_error(
+					"Unrecognised escape sequence: \\" + QString(ch) + " at " + LineIndex(q).describe(i),
 					QStringRef(&q,  (i >= ctx) ? i - ctx : 0,  (i + ctx < q.size()) ? i + ctx : q.size() - 1).toString()
 				);
-				msgbox->exec();
-				delete msgbox;
 				goto goto_RE_tff_cleanup;
 			}
 			
-			buf[j++] = ch;
+			if (opens_group(ch)){
+				i = emit_open_bracket(q,  {i - 1 /* The backslash */,  i + 1},  i + 1);
+				continue;
+			}
+			emit_char(ch,  {i - 1 /* The backslash */,  i + 1});
 			++i;
 			continue;
 		}
@@ -255,6 +518,26 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 			const int substitute_var_name_start = i;
 			while(q.at(i++) != QChar('}'));
 			const QStringRef substitute_var_name(&q,  substitute_var_name_start,  i - 1 /* backtrack } */ - substitute_var_name_start);
+			if (substitute_var_name.startsWith(QChar('@'))){
+				const QString path = QDir(this->include_dir).filePath(substitute_var_name.mid(1).toString());
+				QString words_regex;
+				QString error;
+				bool ok;
+				{
+					EGIX_TRACE_SCOPE("word list");
+					ok = word_list_regex(path, words_regex, error);
+				}
+				if (!ok){
+					this->preprocessor_error(
+						"Cannot include word list: " + path + "\nAt " + LineIndex(q).describe(substitute_var_name_start),
+						error
+					);
+					goto goto_RE_tff_cleanup;
+				}
+				emit_substituted("(?:" + words_regex + ")",  GroupTable(),  {substitute_var_name_start - 2,  i});
+				do_not_optimise_this_group = true; // The trie is already optimised, and may be far too large to pass to regopt.pl as an argument
+				continue;
+			}
 			QStringRef var = nullptr;
 			for (size_t k = var_names.size();  k != 0;  ){
 				--k;
@@ -262,6 +545,18 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 					continue;
 				var = var_values[k];
 			}
+			if (var == nullptr  &&  this->predefined_vars != nullptr){
+				// Declared by another file of the project
+				const VarValue* predefined = nullptr;
+				for (const VarValue& v : *this->predefined_vars)
+					if (predefined == nullptr  &&  v.name == substitute_var_name)
+						predefined = &v;
+				if (predefined != nullptr){
+					emit_substituted(predefined->value,  predefined->groups,  {substitute_var_name_start - 2,  i});
+					this->ensure_buf_sized(j);
+					continue;
+				}
+			}
 			if (var == nullptr){
 				// Variable of the given name was not declared before
 				QString msg = "Previously defined variables:";
@@ -269,17 +564,15 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 					msg += "\n";
 					msg += var_names[--k];
 				}
-				MsgBox* msgbox = new MsgBox(
-					0,  
-					"Undeclared variable: " + substitute_var_name + "\nAt line " + QString::number(get_line_n(q, i)),
+				this->preprocessor_error(
+					"Undeclared variable: " + substitute_var_name + "\nAt " + LineIndex(q).describe(substitute_var_name_start),
 					msg
 				);
-				msgbox->exec();
-				delete msgbox;
 				goto goto_RE_tff_cleanup;
 			}
-			buf += var;
-			j += var.size();
+			const int dst = j;
+			emit_substituted(var.toString(),  this->groups->slice(var.position(),  var.size()),  {substitute_var_name_start - 2,  i});
+			this->source_map->copy(dst,  var.position(),  var.size()); // Character for character, rather than all to the ${VAR}
 			this->ensure_buf_sized(j);
 			continue;
 		}
@@ -298,13 +591,16 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 			size_t k = var_values.size();
 			while(true){
 				if (k == 0){
-					QMessageBox::warning(0,  "Unacceptable Syntax",  QString("Line %1: Encountered unescaped '}' without preceding '{?P<VARNAME>' or '${VARNAME'").arg(get_line_n(q, i)));
+					this->preprocessor_error(QString("Unacceptable Syntax: %1: Encountered unescaped '}' without preceding '{?P<VARNAME>' or '${VARNAME'").arg(LineIndex(q).describe(i)),  QString());
 					goto goto_RE_tff_cleanup;
 				}
 				if (var_values[--k] == nullptr)
 					break;
 			}
 			var_values[k] = QStringRef(&buf,  var_starts[k],  j - var_starts[k]);
+			if (this->declared_vars != nullptr)
+				// Copied now, as later optimisations may rewrite this part of buf
+				this->declared_vars->push_back({var_names[k].toString(),  var_values[k].toString(),  this->groups->slice(var_starts[k],  j - var_starts[k])});
 			++i;
 			continue;
 		}
@@ -334,14 +630,11 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 					if (optimise  and  q.at(i) == QChar('N')  and  q.at(i+1) == QChar('o')  and  q.at(i+2) == QChar('O')  and  q.at(i+3) == QChar('p')  and  q.at(i+4) == QChar('t')){
 						do_not_optimise_this_group = true;
 					} else {
-						MsgBox* msgbox = new MsgBox(
-							0,  
-							"Unrecognised flag: " + QStringRef(&q,  i,  _end_of_flag - i) + " at line " + QString::number(get_line_n(q, i)),
+						this->preprocessor_error(
+							"Unrecognised flag: " + QStringRef(&q,  i,  _end_of_flag - i) + " at " + LineIndex(q).describe(i),
 							"Recognised flags:\n"
 							"	NoOpt"
 						);
-						msgbox->exec();
-						delete msgbox;
 						goto goto_RE_tff_cleanup;
 					}
 				}
@@ -357,12 +650,22 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 				group_start_offset = 0;
 				if (q.at(i+1) == QChar('?')  &&  q.at(i+2) == QChar(':'))
 					group_start_offset += 3;
+				else if (q.at(i+1) == QChar('?')  &&  q.at(i+2) == QChar('P')  &&  q.at(i+3) == QChar('<')  &&  convert_named_groups)
+					group_start_offset += 1; // The name is not emitted
 				else if (q.at(i+1) == QChar('?')  &&  q.at(i+2) == QChar('P')  &&  q.at(i+3) == QChar('<')){
 					group_start_offset += 4;
 					while(q.at(i+group_start_offset) != QChar('>')){
 						++group_start_offset;
 					}
 					++group_start_offset;
+				} else if (q.at(i+1) == QChar('?')  &&  ((q.at(i+2) == QChar('<')  &&  q.at(i+3) != QChar('=')  &&  q.at(i+3) != QChar('!'))  ||  q.at(i+2) == QChar('\''))){
+					// (?<name> or (?'name', whose name is always emitted
+					const QChar terminator = (q.at(i+2) == QChar('<')) ? QChar('>') : QChar('\'');
+					group_start_offset += 3;
+					while(q.at(i+group_start_offset) != terminator){
+						++group_start_offset;
+					}
+					++group_start_offset;
 				} else group_start_offset += 1;
 				on_line_where_group_was_declared = true; // To allow capture group flags - such as #DoNotOptimise - to be declared inline with the group declaration, as a comment
 				do_not_optimise_this_group = false;
@@ -372,22 +675,36 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 				const QStringRef group_text(&buf,  group_start_actual,  j - group_start_actual);
 				QString group_replacement;
 				const QString group_str = group_text.toString();
-				QString s = group_str;
-				optimise_regex(s, group_replacement);
-				buf.replace(group_start_actual,  j - group_start_actual,  group_replacement);
-				return to_final_format(optimise,  buf,  i,  group_start_actual + group_replacement.size(),  group_start,  var_depth);
+				if (this->choose_group_form(optimise, group_str, group_replacement)){
+					buf.replace(group_start_actual,  j - group_start_actual,  group_replacement);
+					// The optimised group no longer corresponds character-by-character to the source, so all of it maps to the group's entire source
+					const int group_src_start = (group_start_actual < this->source_map->size()) ? this->source_map->lookup(group_start_actual).start : i;
+					this->source_map->add_span(group_start_actual,  group_replacement.size(),  {group_src_start, i});
+					this->groups->truncate(group_start_actual);
+					group_stack.erase(std::remove_if(group_stack.begin(),  group_stack.end(),  [&](const int g){ return g >= (int)this->groups->size(); }),  group_stack.end());
+					return to_final_format(q,  optimise,  convert_named_groups,  buf,  i,  group_start_actual + group_replacement.size(),  group_start,  var_depth);
+				}
+				group_start = 0; // The original form is faster, so is kept as it is
 			}
 		}
 		
-		buf[j++] = c;
+		if (opens_group(c)){
+			i = emit_open_bracket(q,  {i, i + 1},  i + 1);
+			continue;
+		}
+		emit_char(c,  {i, i + 1});
 		
 		++i;
 	}
 	buf.resize(j); // Strips excess space, as buf is guaranteed to be smaller than q (until variable substitution is implemented)
+	this->source_map->truncate(j);
 	
 	var_names.clear();
 	var_values.clear();
 	var_starts.clear();
+	group_stack.clear();
+	regex_escaped = false;
+	regex_set_len = -1;
 	
 	return true;
 
@@ -395,34 +712,30 @@ bool RegexEditor::to_final_format(const bool optimise,  QString& buf,  int i,  i
 	var_names.clear();
 	var_values.clear();
 	var_starts.clear();
+	group_stack.clear();
+	regex_escaped = false;
+	regex_set_len = -1;
 	return false;
 }
 
 void RegexEditor::test_regex(){
-	QString buf; // Dummy character to create space for 1 char at beginning
-	buf.reserve(this->text_editor->toPlainText().size());
-	if (!this->to_final_format(this->does_user_want_optimisations(), buf, 0, 0))
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+	const QString src = this->text_editor->toPlainText();
+	QString buf;
+	buf.reserve(src.size());
+	if (!this->to_final_format(src, this->optimisation_mode(), true, buf, 0, 0))
 		return;
 	
 	QByteArray ba = buf.toLocal8Bit();
-	char* const s = ba.data();
-	
-	printf("[%lu] %s\n", strlen(s), s);
-	
-	std::vector<char*> reason_name2id = {"None", "Unspecified"};
-	std::vector<int> groupindx2reason;
-	std::vector<char*> group_starts;
-	std::vector<char*> group_ends;
-	std::vector<bool> record_contents;
-	
-	compsky::regex::convert_named_groups(s,  s,  reason_name2id,  groupindx2reason, record_contents, group_starts, group_ends);
-	printf("%s\n", s);
+	const char* const s = ba.constData();
 	
 	try {
+		EGIX_TRACE_SCOPE("boost compile");
 		auto r = new boost::basic_regex<char, boost::cpp_regex_traits<char>>(s,  boost::regex::perl);
 		delete r;
 	} catch (boost::regex_error& e){
-		MsgBox* msgbox = new MsgBox(0, e.what(), s, 720);
+		const SourceSpan span = this->source_map->lookup(e.position());
+		MsgBox* msgbox = new MsgBox(0,  QString(e.what()) + "\nAt " + LineIndex(src).describe(span.start),  s,  720);
 		msgbox->exec();
 		delete msgbox;
 		return;
@@ -431,35 +744,29 @@ void RegexEditor::test_regex(){
 	QString report = "";
 
 	bool try_exrex = true;
-	report += QString::number(group_starts.size() - 1);
+	report += QString::number(this->groups->size());
 	report += " Capture Groups:";
-	for (size_t i = 1;  i < groupindx2reason.size();  ++i){
+	for (size_t g = 0;  g < this->groups->size();  ++g){
 		report += "\n";
-		report += QString::number(i);
+		report += QString::number(g + 1);
 		report += "\t";
-		report += (record_contents[i]) ? "[Record contents]" : "[Count occurances]";
+		report += (this->groups->record_contents[g]) ? "[Record contents]" : "[Count occurances]";
 		report += "\t";
-		report += reason_name2id[groupindx2reason[i]];
+		report += this->groups->reasons[this->groups->reason[g]];
 		report += "\n\t";
 
-		// WARNING: The following calculates the number of bytes, NOT the number of characters. QStrings are UTF-16, so some characters are multiple bytes. This is also why QStringRef is not used shortly after.
-		const int group_source_strlen = (uintptr_t)(group_ends[i]) - (uintptr_t)(group_starts[i]) - 1;
-
-		if (group_ends[i] == nullptr){
-			QMessageBox::critical(0,  "Bug",  QString("Cannot locate group %1's end.\nGroup begins at the %2th position in the final (processed) regex.\nGroup may begin around line %3.").arg(i).arg(groupindx2reason[i]).arg(get_line_n(this->text_editor->toPlainText(), groupindx2reason[i])));
+		if (this->groups->close[g] == -1){
+			QMessageBox::critical(0,  "Bug",  QString("Cannot locate group %1's end.\nGroup begins at %2 of the source.").arg(g + 1).arg(LineIndex(src).describe(this->source_map->lookup(this->groups->open[g]).start)));
 			return;
 		}
-		const char c = group_ends[i][0];
-		group_ends[i][0] = 0;
-		QString group_source = group_starts[i];
-		group_ends[i][0] = c;
-		group_source.resize(group_source_strlen);
+		const QString group_source = this->groups->body(buf, g);
 
 		// TODO: Optionally truncate large sources
 
 		report += group_source;
 		
 		if (try_exrex){
+			EGIX_TRACE_SCOPE("exrex");
 			QProcess exrex;
 			QString output;
 			
@@ -483,19 +790,20 @@ void RegexEditor::test_regex(){
 	delete msgbox;
 }
 
-bool RegexEditor::does_user_want_optimisations() const {
-	return this->want_optimisations->isChecked();
+RegexEditor::OptimisationMode RegexEditor::optimisation_mode() const {
+	return static_cast<OptimisationMode>(this->want_optimisations->currentIndex());
 }
 
 
 void RegexEditor::dehumanise(){
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
 	QString buf;
 	const int buf_sz = this->text_editor->toPlainText().size() + 1; // Extra char for trailing \0
 	buf.reserve(buf_sz);
 	
 	this->ensure_buf_sized(buf_sz);
 	
-	if (!this->to_final_format(this->does_user_want_optimisations(), buf, 0, 0))
+	if (!this->to_final_format(this->text_editor->toPlainText(), this->optimisation_mode(), false, buf, 0, 0))
 		return;
 	
 	MsgBox* const msgbox = new MsgBox(this, "Dehumanised Form", buf, 720);
@@ -514,29 +822,45 @@ QString RegexEditor::get_text() const {
 }
 
 
-void RegexEditor::load_file(){
-	QFileDialog dialog(this);
-	dialog.setFileMode(QFileDialog::AnyFile);
-	dialog.setAcceptMode(QFileDialog::AcceptOpen);
-	if (!dialog.exec())
-		return;
-	
-	QString const file_path = dialog.selectedFiles()[0];
-	
+static
+bool read_file(const QString& file_path,  QString& content,  QString* const error = nullptr){
+	// If error is given, it is set rather than shown in a dialog
 	QFile f(file_path);
 	if (!f.open(QIODevice::ReadOnly)){
-		QMessageBox::information(0, "Cannot open file", f.errorString());
-		return;
+		if (error != nullptr)
+			*error = f.errorString();
+		else
+			QMessageBox::information(0, "Cannot open file", f.errorString());
+		return false;
 	}
 	
 	QTextStream in(&f);
 	
-	QString content = "";
+	content = "";
 	while(!in.atEnd()) {
 		content += in.readLine() + "\n";
 	}
 	
 	f.close();
+	return true;
+}
+
+
+void RegexEditor::load_file(){
+	QFileDialog dialog(this);
+	dialog.setFileMode(QFileDialog::AnyFile);
+	dialog.setAcceptMode(QFileDialog::AcceptOpen);
+	if (!dialog.exec())
+		return;
+	
+	QString content;
+	if (!read_file(dialog.selectedFiles()[0], content))
+		return;
+	{
+		// Used by the live preprocessor
+		const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+		this->include_dir = QFileInfo(dialog.selectedFiles()[0]).absolutePath();
+	}
 	
 	this->text_editor->setPlainText(content);
 }
@@ -550,6 +874,11 @@ void RegexEditor::save_to_file(){
 		return;
 	
 	QString const file_path = dialog.selectedFiles()[0];
+	{
+		// Used by the live preprocessor
+		const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+		this->include_dir = QFileInfo(file_path).absolutePath();
+	}
 	
 	QFile f(file_path);
 	if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)){
@@ -561,3 +890,700 @@ void RegexEditor::save_to_file(){
 	out << this->text_editor->toPlainText();
 	f.close();
 }
+
+
+void RegexEditor::compile_pattern_set(){
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+	QFileDialog dialog(this);
+	dialog.setFileMode(QFileDialog::ExistingFiles);
+	dialog.setAcceptMode(QFileDialog::AcceptOpen);
+	if (!dialog.exec())
+		return;
+	
+	PatternSet set;
+	const QString editor_include_dir = this->include_dir;
+	for (const QString& file_path : dialog.selectedFiles()){
+		QString content;
+		if (!read_file(file_path, content)){
+			this->include_dir = editor_include_dir;
+			return;
+		}
+		this->include_dir = QFileInfo(file_path).absolutePath();
+		QString buf;
+		buf.reserve(content.size());
+		if (!this->to_final_format(content, this->optimisation_mode(), false, buf, 0, 0)){
+			QMessageBox::warning(0,  "Cannot preprocess",  file_path);
+			this->include_dir = editor_include_dir;
+			return;
+		}
+		QString error;
+		if (!set.add(file_path,  buf,  *this->groups,  error)){
+			QMessageBox::warning(0,  "Cannot add to set",  QString("%1\n%2").arg(file_path).arg(error));
+			this->include_dir = editor_include_dir;
+			return;
+		}
+	}
+	this->include_dir = editor_include_dir;
+	
+	QByteArray ba = set.combined_converted.toLocal8Bit();
+	const char* const s = ba.constData();
+	
+	try {
+		EGIX_TRACE_SCOPE("boost compile");
+		auto r = new boost::basic_regex<char, boost::cpp_regex_traits<char>>(s,  boost::regex::perl);
+		delete r;
+	} catch (boost::regex_error& e){
+		MsgBox* msgbox = new MsgBox(0, e.what(), s, 720);
+		msgbox->exec();
+		delete msgbox;
+		return;
+	}
+	
+	QString mapping = "group\tsource\treason\n";
+	QString report = QString("%1 sources, %2 capture groups").arg(set.sources.size()).arg(set.group_reasons.size() - 1);
+	for (size_t i = 1;  i < set.group_reasons.size();  ++i){
+		const PatternSetSource* const src = set.source_of_group(i);
+		const QString src_path = (src == nullptr) ? QString("?") : src->file_path;
+		report += QString("\n%1\t%2\t%3").arg(i).arg(src_path).arg(set.group_reasons[i]);
+		mapping += QString("%1\t%2\t%3\n").arg(i).arg(src_path).arg(set.group_reasons[i]);
+	}
+	
+	MsgBox* msgbox = new MsgBox(0, "Pattern Set", report, 720);
+	msgbox->exec();
+	delete msgbox;
+	
+	QFileDialog save_dialog(this);
+	save_dialog.setFileMode(QFileDialog::AnyFile);
+	save_dialog.setAcceptMode(QFileDialog::AcceptSave);
+	if (!save_dialog.exec())
+		return;
+	
+	// The combined regex is saved before named group conversion, so consumers can apply their own; its groups are numbered identically to the mapping file.
+	const QString file_path = save_dialog.selectedFiles()[0];
+	for (int k = 0;  k < 2;  ++k){
+		QFile f((k == 0) ? file_path : file_path + ".groups.tsv");
+		if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+			QMessageBox::information(0, "Cannot open file for writing", f.errorString());
+			return;
+		}
+		QTextStream out(&f);
+		out << ((k == 0) ? set.combined : mapping);
+		f.close();
+	}
+}
+
+
+bool RegexEditor::load_corpus(){
+	QFileDialog dialog(this);
+	dialog.setFileMode(QFileDialog::ExistingFile);
+	dialog.setAcceptMode(QFileDialog::AcceptOpen);
+	dialog.setWindowTitle("Corpus (one record per line)");
+	if (!dialog.exec())
+		return false;
+	
+	Corpus* const c = new Corpus;
+	if (!c->open(dialog.selectedFiles()[0])){
+		QMessageBox::information(0, "Cannot open corpus", c->error_string());
+		delete c;
+		return false;
+	}
+	this->preview->set_corpus(c);
+	this->stop_group_profiler(); // It may still be reading the previous corpus
+	delete this->corpus;
+	this->corpus = c;
+	this->live_compile_timer->start();
+	return true;
+}
+
+
+void RegexEditor::profile_groups(){
+	if (this->group_profiler.joinable()){
+		QMessageBox::information(0,  "Profile",  "The groups are still being profiled");
+		return;
+	}
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+	if (this->corpus == nullptr  &&  !this->load_corpus())
+		return;
+	
+	const QString src = this->text_editor->toPlainText();
+	QString buf;
+	buf.reserve(src.size());
+	if (!this->to_final_format(src, this->optimisation_mode(), true, buf, 0, 0))
+		return;
+	
+	const LineIndex line_index(src);
+	std::vector<GroupProfile> profiles;
+	for (size_t g = 0;  g < this->groups->size();  ++g){
+		if (this->groups->close[g] == -1)
+			continue;
+		GroupProfile p;
+		p.group = g + 1;
+		p.reason = this->groups->reasons[this->groups->reason[g]];
+		p.source = this->groups->body(buf, g);
+		p.line = line_index.position(this->source_map->lookup(this->groups->open[g]).start).line;
+		p.end_line = line_index.position(this->source_map->lookup(this->groups->close[g]).start).line;
+		profiles.push_back(p);
+	}
+	
+	// Timed on a worker, like the preview, so that the editor stays responsive
+	const Corpus* const corpus = this->corpus;
+	const int revision = this->text_editor->document()->revision();
+	this->group_profiler_cancelled = false;
+	this->group_profiler = std::thread([this, profiles, corpus, revision]() mutable {
+		for (GroupProfile& p : profiles)
+			profile_group(p,  *corpus,  this->group_profiler_cancelled);
+		if (!this->group_profiler_cancelled)
+			QMetaObject::invokeMethod(this,  [this, profiles, revision](){ this->groups_profiled(profiles, revision); },  Qt::QueuedConnection);
+	});
+}
+
+
+void RegexEditor::groups_profiled(const std::vector<GroupProfile>& profiles,  const int revision){
+	if (this->group_profiler.joinable())
+		this->group_profiler.join();
+	
+	std::vector<float> heat(this->text_editor->document()->blockCount(),  0);
+	double max_ms = 0;
+	for (const GroupProfile& p : profiles)
+		if (p.ms > max_ms)
+			max_ms = p.ms;
+	if (max_ms != 0  &&  revision == this->text_editor->document()->revision()){
+		// Groups are ordered by their opening bracket, so inner groups overwrite the heat of the outer groups containing them
+		for (const GroupProfile& p : profiles)
+			for (int line = p.line;  line <= p.end_line  &&  line <= (int)heat.size();  ++line)
+				heat[line - 1] = p.ms / max_ms;
+	}
+	this->highlighter->set_line_heat(heat);
+	
+	GroupProfileDialog* const dialog = new GroupProfileDialog(profiles, this);
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
+	dialog->show();
+}
+
+
+void RegexEditor::stop_group_profiler(){
+	if (!this->group_profiler.joinable())
+		return;
+	this->group_profiler_cancelled = true;
+	this->group_profiler.join();
+}
+
+
+static
+bool exrex_examples(const QStringList& regexes,  const int n_enumerated,  const int n_random,  std::vector<std::string>& examples){
+	// A single process generates every example of every regex, as starting python takes far longer than generating an example
+	static const char* const script =
+		"import itertools, sys, exrex\n"
+		"n_enumerated, n_random = int(sys.argv[1]), int(sys.argv[2])\n"
+		"for regex in sys.argv[3:]:\n"
+		"	try:\n"
+		"		for s in itertools.islice(exrex.generate(regex), n_enumerated):\n"
+		"			print(s)\n"
+		"		for _ in range(n_random):\n"
+		"			print(exrex.getone(regex))\n"
+		"	except Exception:\n"
+		"		pass # exrex does not support all of boost's syntax\n"
+	;
+	EGIX_TRACE_SCOPE("exrex");
+	QProcess exrex;
+	exrex.start("python3",  QStringList{"-c",  script,  QString::number(n_enumerated),  QString::number(n_random)} + regexes);
+	if (!exrex.waitForFinished()  ||  exrex.exitStatus() != QProcess::NormalExit  ||  exrex.exitCode() != 0)
+		// Most likely, exrex is not installed
+		return false;
+	for (const QByteArray& line : exrex.readAllStandardOutput().split('\n'))
+		if (!line.isEmpty())
+			examples.emplace_back(line.constData(),  line.size());
+	exrex.close();
+	return true;
+}
+
+
+void RegexEditor::verify_optimisations(){
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+	constexpr static const int n_random_examples = 20;
+	constexpr static const int n_enumerated_examples = 200;
+	constexpr static const size_t n_mutants_per_example = 8;
+	constexpr static const size_t max_regressions = 1000; // All are retested on every run, so only the most recent are kept
+	
+	const QString src = this->text_editor->toPlainText();
+	const OptimisationMode optimised_mode = (this->optimisation_mode() == optimise_if_faster) ? optimise_if_faster : optimise_all;
+	QByteArray final_regex[2]; // Unoptimised, optimised
+	for (auto k = 0;  k < 2;  ++k){
+		QString buf;
+		buf.reserve(src.size());
+		if (!this->to_final_format(src,  (k == 0) ? dont_optimise : optimised_mode,  true,  buf,  0,  0))
+			return;
+		final_regex[k] = buf.toLocal8Bit();
+	}
+	
+	Regex* r[2];
+	for (auto k = 0;  k < 2;  ++k){
+		try {
+			EGIX_TRACE_SCOPE("boost compile");
+			r[k] = new Regex(final_regex[k].constData(),  boost::regex::perl);
+		} catch (boost::regex_error& e){
+			if (k == 1)
+				delete r[0];
+			MsgBox* msgbox = new MsgBox(0,  (k == 0) ? "Unoptimised regex is invalid" : "Optimised regex is invalid",  e.what(),  720);
+			msgbox->exec();
+			delete msgbox;
+			return;
+		}
+	}
+	
+	// Positive examples of either regex, followed by their mutants (mostly negative examples)
+	std::vector<std::string> generated;
+	const bool have_exrex = exrex_examples({QString::fromLocal8Bit(final_regex[0]),  QString::fromLocal8Bit(final_regex[1])},  n_enumerated_examples,  n_random_examples,  generated);
+	std::vector<std::string> mutants;
+	mutate_strings(generated,  mutants,  qHash(src),  n_mutants_per_example);
+	
+	// Strings that previously exposed a difference are always retested
+	const QString data_dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+	QDir().mkpath(data_dir);
+	const QString regressions_path = data_dir + "/verify_regressions.txt";
+	std::vector<std::string> regressions;
+	std::unordered_set<std::string> known_regressions;
+	{
+		QFile f(regressions_path);
+		if (f.open(QIODevice::ReadOnly)){
+			for (const QByteArray& line : f.readAll().split('\n')){
+				if (line.isEmpty())
+					continue;
+				const QByteArray s = QByteArray::fromPercentEncoding(line);
+				std::string str(s.constData(),  s.size());
+				if (known_regressions.insert(str).second)
+					regressions.push_back(std::move(str));
+			}
+			f.close();
+		}
+		if (regressions.size() > max_regressions)
+			regressions.erase(regressions.begin(),  regressions.end() - max_regressions);
+	}
+	
+	std::vector<CorpusRecord> inputs;
+	for (const std::vector<std::string>* strs : {&generated, &mutants, &regressions})
+		for (const std::string& str : *strs)
+			inputs.push_back({str.data(),  str.data() + str.size()});
+	
+	RegexDiffResult result;
+	diff_regexes(*r[0],  *r[1],  inputs,  result);
+	const double generated_ms[2] = {result.ms_a, result.ms_b};
+	if (this->corpus != nullptr)
+		diff_regexes(*r[0],  *r[1],  this->corpus->records,  result);
+	
+	delete r[0];
+	delete r[1];
+	
+	{
+		// Rewritten rather than appended to, so that it holds no duplicates, and no more than max_regressions strings
+		std::vector<std::string> kept = regressions;
+		for (const std::string& s : result.disagreements)
+			if (known_regressions.insert(s).second)
+				kept.push_back(s);
+		if (kept.size() > max_regressions)
+			kept.erase(kept.begin(),  kept.end() - max_regressions);
+		QFile f(regressions_path);
+		if (f.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+			for (const std::string& s : kept)
+				f.write(QByteArray(s.data(), s.size()).toPercentEncoding() + "\n");
+			f.close();
+		}
+	}
+	{
+		QFile f(data_dir + "/verify_log.tsv");
+		if (f.open(QIODevice::WriteOnly | QIODevice::Append)){
+			QTextStream out(&f);
+			out << QDateTime::currentDateTime().toString(Qt::ISODate) << "\t"
+			    << QCryptographicHash::hash(src.toUtf8(), QCryptographicHash::Sha1).toHex() << "\t"
+			    << result.n_inputs << "\t"
+			    << result.n_disagreements << "\t"
+			    << result.ms_a << "\t"
+			    << result.ms_b << "\n";
+			f.close();
+		}
+	}
+	
+	QString report = QString("%1 inputs (%2 generated, %3 mutants, %4 regressions, %5 corpus records)\n%6 disagreements, of which %7 only on the spans of groups\n")
+		.arg(result.n_inputs)
+		.arg(generated.size())
+		.arg(mutants.size())
+		.arg(regressions.size())
+		.arg((this->corpus == nullptr) ? 0 : this->corpus->records.size())
+		.arg(result.n_disagreements)
+		.arg(result.n_span_disagreements);
+	if (result.n_failures != 0)
+		report += QString("boost gave up (e.g. ran out of stack space) on %1 inputs with one or both regexes\n").arg(result.n_failures);
+	if (!result.compared_groups)
+		report += "The regexes have different numbers of groups, so only the spans of their whole matches were compared\n";
+	report += "\n";
+	report += QString("Generated inputs:\t%1ms unoptimised\t%2ms optimised\n").arg(generated_ms[0]).arg(generated_ms[1]);
+	if (this->corpus != nullptr)
+		report += QString("Corpus:\t%1ms unoptimised\t%2ms optimised\n").arg(result.ms_a - generated_ms[0]).arg(result.ms_b - generated_ms[1]);
+	if (result.ms_a != 0)
+		report += QString("Speed-up:\t%1%\n").arg(100.0 * (result.ms_a - result.ms_b) / result.ms_a,  0,  'f',  1);
+	if (!have_exrex)
+		report += "\nTo generate example strings, pip install exrex\n";
+	
+	QString details;
+	for (const std::string& s : result.disagreements){
+		details += QString::fromLocal8Bit(s.data(), s.size());
+		details += "\n";
+	}
+	
+	MsgBox* msgbox = new MsgBox(0,  (result.n_disagreements == 0) ? "Optimised regex agrees" : "Optimised regex DISAGREES",  report + details,  720);
+	msgbox->exec();
+	delete msgbox;
+}
+
+
+void RegexEditor::benchmark_dfa(){
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+	const QString src = this->text_editor->toPlainText();
+	QString buf;
+	buf.reserve(src.size());
+	if (!this->to_final_format(src, this->optimisation_mode(), true, buf, 0, 0))
+		return;
+	QByteArray ba = buf.toLocal8Bit();
+	
+	std::unique_ptr<Matcher> matcher;
+	try {
+		EGIX_TRACE_SCOPE("matcher compile");
+		matcher.reset(new Matcher(ba.constData()));
+	} catch (boost::regex_error& e){
+		MsgBox* msgbox = new MsgBox(0, e.what(), ba, 720);
+		msgbox->exec();
+		delete msgbox;
+		return;
+	}
+	
+	QString report;
+	if (matcher->dfa == nullptr){
+		report = QString("Cannot use a DFA: %1\nboost will be used instead").arg(QString::fromStdString(matcher->fallback_reason));
+	} else {
+		report = QString("DFA: %1 states, %2 byte classes, %3 bytes").arg(matcher->dfa->n_states()).arg(matcher->dfa->n_classes()).arg(matcher->dfa->memory());
+		
+		if (this->corpus == nullptr){
+			report += "\n\nLoad a corpus to benchmark the DFA against boost";
+		} else {
+			const boost::basic_regex<char, boost::cpp_regex_traits<char>> r(ba.constData(),  boost::regex::perl);
+			size_t n_matches[2] = {0, 0};
+			size_t n_disagreements = 0;
+			double ms[2] = {0, 0};
+			std::vector<char> dfa_found(this->corpus->records.size());
+			
+			auto t0 = std::chrono::steady_clock::now();
+			for (size_t i = 0;  i < this->corpus->records.size();  ++i)
+				n_matches[0] += dfa_found[i] = matcher->dfa->search(this->corpus->records[i].begin,  this->corpus->records[i].end);
+			auto t1 = std::chrono::steady_clock::now();
+			ms[0] = std::chrono::duration<double, std::milli>(t1 - t0).count();
+			
+			QString boost_error;
+			size_t i = 0;
+			t0 = std::chrono::steady_clock::now();
+			try {
+				for (;  i < this->corpus->records.size();  ++i){
+					const bool found = boost::regex_search(this->corpus->records[i].begin,  this->corpus->records[i].end,  r);
+					n_matches[1] += found;
+					n_disagreements += (found != (bool)dfa_found[i]);
+				}
+			} catch (std::runtime_error& e){
+				// e.g. boost runs out of stack space, or exceeds its complexity limit, on (a*)*b and a long enough line
+				boost_error = QString("boost gave up on record %1: %2").arg(i + 1).arg(e.what());
+			}
+			t1 = std::chrono::steady_clock::now();
+			ms[1] = std::chrono::duration<double, std::milli>(t1 - t0).count();
+			
+			report += QString("\n\n%1 records\nDFA:\t%2ms\t%3 matches").arg(this->corpus->records.size()).arg(ms[0]).arg(n_matches[0]);
+			if (boost_error.isEmpty())
+				report += QString("\nboost:\t%1ms\t%2 matches").arg(ms[1]).arg(n_matches[1]);
+			else
+				report += "\nboost:\t" + boost_error;
+			if (n_disagreements != 0)
+				report += QString("\n\nBUG: The DFA and boost disagree on %1 records").arg(n_disagreements);
+		}
+	}
+	
+	MsgBox* msgbox = new MsgBox(0, "DFA", report, 720);
+	msgbox->exec();
+	delete msgbox;
+}
+
+
+void RegexEditor::live_compile(){
+	if (this->corpus == nullptr){
+		this->preview->show_status("Load a corpus to preview matches");
+		return;
+	}
+	if (this->live_preprocessor.joinable()){
+		// The latest text is preprocessed once the current run is done
+		this->live_compile_pending = true;
+		return;
+	}
+	
+	const QString src = this->text_editor->toPlainText();
+	this->live_preprocessor = std::thread([this, src](){
+		QString buf;
+		buf.reserve(src.size());
+		std::vector<QString> group_names(1,  "Match");
+		bool ok;
+		QString error;
+		{
+			const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+			this->quiet_errors = true;
+			this->preprocessor_error_text.clear();
+			ok = this->to_final_format(src, dont_optimise, true, buf, 0, 0); // regopt.pl is far too slow to run on every edit
+			this->quiet_errors = false;
+			error = this->preprocessor_error_text;
+			for (const int reason : this->groups->reason)
+				group_names.push_back(this->groups->reasons[reason]);
+		}
+		const QByteArray regex = buf.toLocal8Bit();
+		QMetaObject::invokeMethod(this,  [this, ok, error, regex, group_names](){ this->live_compiled(ok, error, regex, group_names); },  Qt::QueuedConnection);
+	});
+}
+
+
+void RegexEditor::live_compiled(const bool ok,  const QString& error,  const QByteArray& regex,  const std::vector<QString>& group_names){
+	// Runs on the GUI thread, once live_preprocessor has posted its results
+	this->live_preprocessor.join();
+	if (this->live_compile_pending){
+		// The results are already stale
+		this->live_compile_pending = false;
+		this->live_compile();
+		return;
+	}
+	if (!ok){
+		this->preview->show_status(error);
+		return;
+	}
+	this->preview->run(regex,  group_names);
+}
+
+
+void RegexEditor::show_metrics(){
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+	const QString src = this->text_editor->toPlainText();
+	const OptimisationMode optimised_mode = (this->optimisation_mode() == optimise_if_faster) ? optimise_if_faster : optimise_all;
+	RegexMetrics metrics[2]; // Unoptimised, optimised
+	QString timing_aborted[2]; // Why boost gave up matching the corpus, if it did
+	for (auto k = 0;  k < 2;  ++k){
+		QString buf;
+		buf.reserve(src.size());
+		if (!this->to_final_format(src,  (k == 0) ? dont_optimise : optimised_mode,  true,  buf,  0,  0))
+			return;
+		const QByteArray ba = buf.toLocal8Bit();
+		boost::basic_regex<char, boost::cpp_regex_traits<char>> r;
+		try {
+			EGIX_TRACE_SCOPE("boost compile");
+			r.assign(ba.constData(),  boost::regex::perl);
+			measure_regex(r,  ba.constData(),  metrics[k]);
+		} catch (boost::regex_error& e){
+			MsgBox* msgbox = new MsgBox(0,  (k == 0) ? "Unoptimised regex is invalid" : "Optimised regex is invalid",  e.what(),  720);
+			msgbox->exec();
+			delete msgbox;
+			return;
+		}
+		if (this->corpus == nullptr)
+			continue;
+		try {
+			time_regex(r,  this->corpus->records,  metrics[k]);
+		} catch (std::runtime_error& e){
+			// The regex is valid, but boost gave up on a record - e.g. it ran out of stack space
+			metrics[k].us_per_kib = -1;
+			timing_aborted[k] = e.what();
+		}
+	}
+	
+	QString report = "\tUnoptimised\tOptimised\n";
+	auto add_row = [&](const char* name,  const size_t a,  const size_t b){
+		report += QString("%1\t%2\t%3\n").arg(name).arg(a).arg(b);
+	};
+	auto add_real_row = [&](const char* name,  const double a,  const double b){
+		report += QString("%1\t%2\t%3\n").arg(name).arg(a, 0, 'f', 3).arg(b, 0, 'f', 3);
+	};
+	add_row("Pattern length",        metrics[0].pattern_len,          metrics[1].pattern_len);
+	add_row("Capture groups",        metrics[0].n_groups,             metrics[1].n_groups);
+	add_row("Atoms",                 metrics[0].n_atoms,              metrics[1].n_atoms);
+	add_row("Alternatives",          metrics[0].n_alternatives,       metrics[1].n_alternatives);
+	add_row("Repeats",               metrics[0].n_repeats,            metrics[1].n_repeats);
+	add_row("Nested repeats",        metrics[0].n_nested_repeats,     metrics[1].n_nested_repeats);
+	add_row("Backreferences",        metrics[0].n_backrefs,           metrics[1].n_backrefs);
+	if (metrics[0].compiled_bytes != 0)
+		add_row("Compiled bytes",    metrics[0].compiled_bytes,       metrics[1].compiled_bytes);
+	add_real_row("Cost (heuristic)",  metrics[0].est_cost,  metrics[1].est_cost);
+	add_row("DFA states",            metrics[0].dfa_states,           metrics[1].dfa_states);
+	add_row("DFA bytes",             metrics[0].dfa_bytes,            metrics[1].dfa_bytes);
+	if (this->corpus != nullptr){
+		QString cells[2];
+		for (auto k = 0;  k < 2;  ++k)
+			cells[k] = (timing_aborted[k].isEmpty()) ? QString::number(metrics[k].us_per_kib, 'f', 3) : QString("matching aborted");
+		report += QString("Corpus us/KiB\t%1\t%2\n").arg(cells[0]).arg(cells[1]);
+		for (auto k = 0;  k < 2;  ++k)
+			if (!timing_aborted[k].isEmpty())
+				report += QString("\n%1 regex: boost gave up matching the corpus: %2\n").arg((k == 0) ? "Unoptimised" : "Optimised").arg(timing_aborted[k]);
+	} else
+		report += "\nLoad a corpus to measure the matching time\n";
+	
+	const QString data_dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+	QDir().mkpath(data_dir);
+	QFile f(data_dir + "/metrics.jsonl");
+	if (f.open(QIODevice::WriteOnly | QIODevice::Append)){
+		QTextStream out(&f);
+		out << "{\"time\":\"" << QDateTime::currentDateTime().toString(Qt::ISODate) << "\""
+		    << ",\"egix\":\"" << EGIX_VERSION << "\""
+		    << ",\"boost\":\"" << BOOST_LIB_VERSION << "\""
+		    << ",\"source_sha1\":\"" << QCryptographicHash::hash(src.toUtf8(), QCryptographicHash::Sha1).toHex() << "\""
+		    << ",\"unoptimised\":" << QString::fromStdString(metrics_to_json(metrics[0]))
+		    << ",\"optimised\":" << QString::fromStdString(metrics_to_json(metrics[1]))
+		    << "}\n";
+		f.close();
+	}
+	
+	MsgBox* msgbox = new MsgBox(0, "Metrics", report, 720);
+	msgbox->exec();
+	delete msgbox;
+}
+
+
+void RegexEditor::build_project(){
+	const QString dir = QFileDialog::getExistingDirectory(this,  "Project directory",  this->project_dir);
+	if (dir.isEmpty())
+		return;
+	this->project_dir = dir;
+	
+	const std::lock_guard<std::mutex> preprocess_lock(this->preprocess_mutex);
+	// Outputs depend on the settings as well as the sources
+	QString build_key = QString("%1\t%2").arg(EGIX_VERSION).arg(this->optimisation_mode());
+	if (this->optimisation_mode() == optimise_if_faster){
+		// The choice of forms depends on the corpus's contents, not just its path
+		if (this->corpus == nullptr)
+			build_key += "\t";
+		else {
+			const QFileInfo corpus_info(this->corpus->file_path());
+			build_key += QString("\t%1\t%2\t%3").arg(corpus_info.absoluteFilePath()).arg(corpus_info.size()).arg(corpus_info.lastModified().toMSecsSinceEpoch());
+		}
+	}
+	Project project;
+	{
+		EGIX_TRACE_SCOPE("project index");
+		if (!project.open(dir, build_key)){
+			QMessageBox::warning(0,  "Cannot open project",  project.error_string());
+			return;
+		}
+	}
+	std::vector<size_t> to_build;
+	for (size_t f = 0;  f < project.files.size();  ++f)
+		if (!project.files[f].built)
+			to_build.push_back(f);
+	std::vector<size_t> order;
+	if (!project.build_order(to_build, order)){
+		QMessageBox::warning(0,  "Cannot build project",  project.error_string());
+		return;
+	}
+	std::vector<bool> rebuild(project.files.size(),  false);
+	for (const size_t f : to_build)
+		rebuild[f] = true;
+	
+	struct Output {
+		size_t file;
+		QString named;
+		QByteArray converted;
+		QString error;
+	};
+	std::vector<Output> outputs;
+	
+	// Preprocessing uses the editor's own state, so is sequential. Files that are not being rebuilt are still preprocessed if they provide variables to those that are.
+	std::vector<std::vector<VarValue>> declared(project.files.size());
+	std::vector<bool> failed(project.files.size(),  false);
+	const QString editor_include_dir = this->include_dir;
+	this->quiet_errors = true;
+	for (const size_t f : order){
+		// A file that cannot be preprocessed fails, as do the files using its variables, but the rest of the project is still built
+		QString error;
+		for (const size_t p : project.providers(f))
+			if (failed[p]  &&  error.isEmpty())
+				error = "Cannot preprocess " + project.files[p].path + ", which declares variables it uses";
+		const QString file_path = QDir(dir).filePath(project.files[f].path);
+		QString content;
+		QString buf;
+		if (error.isEmpty()  &&  read_file(file_path, content, &error)){
+			this->include_dir = QFileInfo(file_path).absolutePath();
+			std::vector<VarValue> predefined;
+			for (const size_t p : project.providers(f))
+				predefined.insert(predefined.end(),  declared[p].begin(),  declared[p].end());
+			this->predefined_vars = &predefined;
+			this->declared_vars = &declared[f];
+			this->preprocessor_error_text.clear();
+			buf.reserve(content.size());
+			if (!this->to_final_format(content, this->optimisation_mode(), false, buf, 0, 0))
+				error = this->preprocessor_error_text;
+			this->predefined_vars = nullptr;
+			this->declared_vars = nullptr;
+		}
+		failed[f] = !error.isEmpty();
+		if (rebuild[f])
+			outputs.push_back({f,  buf,  (failed[f]) ? QByteArray() : this->groups->strip_names(buf).toLocal8Bit(),  error});
+	}
+	this->quiet_errors = false;
+	this->include_dir = editor_include_dir;
+	
+	// Compiling is independent for each file, so is parallel
+	{
+		EGIX_TRACE_SCOPE("project compile");
+		std::atomic<size_t> next(0);
+		auto compile_outputs = [&](){
+			for (size_t k = next++;  k < outputs.size();  k = next++){
+				if (!outputs[k].error.isEmpty())
+					continue;
+				try {
+					const boost::basic_regex<char, boost::cpp_regex_traits<char>> r(outputs[k].converted.constData(),  boost::regex::perl);
+				} catch (boost::regex_error& e){
+					outputs[k].error = e.what();
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		const size_t n_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),  outputs.size());
+		for (size_t t = 1;  t < n_threads;  ++t)
+			threads.emplace_back(compile_outputs);
+		compile_outputs();
+		for (std::thread& t : threads)
+			t.join();
+	}
+	
+	QString details;
+	size_t n_failed = 0;
+	for (const Output& o : outputs){
+		ProjectFile& file = project.files[o.file];
+		QString error = o.error;
+		if (error.isEmpty()){
+			const QString output_path = project.output_path(file.path);
+			QDir().mkpath(QFileInfo(output_path).absolutePath());
+			QFile f(output_path);
+			if (f.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+				QTextStream out(&f);
+				out << o.named;
+				f.close();
+			} else {
+				error = f.errorString();
+			}
+		}
+		file.built = error.isEmpty();
+		if (!file.built){
+			++n_failed;
+			details += file.path + ": " + error + "\n";
+		}
+	}
+	for (const QString& path : project.removed)
+		// The source was deleted or renamed
+		QFile::remove(project.output_path(path));
+	if (!project.save_index())
+		details += "Cannot write the project index\n";
+	for (const QString& warning : project.warnings)
+		details += "WARNING: " + warning + "\n";
+	
+	const QString report = QString("%1 sources\n%2 rebuilt (%3 more preprocessed for their variables)\n%4 failed\n%5 removed").arg(project.files.size()).arg(outputs.size()).arg(order.size() - outputs.size()).arg(n_failed).arg(project.removed.size());
+	MsgBox* msgbox = new MsgBox(0,  report,  details,  720);
+	msgbox->exec();
+	delete msgbox;
+}
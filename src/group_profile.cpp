@@ -0,0 +1,103 @@
+#include "group_profile.hpp"
+#include "corpus.hpp"
+
+#include <boost/regex.hpp>
+
+#include <stdexcept>
+
+#include <QElapsedTimer>
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+
+void profile_group(GroupProfile& profile,  const Corpus& corpus,  const std::atomic<bool>& cancelled){
+	profile.ms = 0;
+	profile.attempts = 0;
+	profile.matches = 0;
+	profile.error.clear();
+	
+	const QByteArray ba = profile.source.toLocal8Bit();
+	boost::basic_regex<char, boost::cpp_regex_traits<char>>* r;
+	try {
+		r = new boost::basic_regex<char, boost::cpp_regex_traits<char>>(ba.constData(),  boost::regex::perl);
+	} catch (boost::regex_error& e){
+		profile.compiled = false;
+		return;
+	}
+	profile.compiled = true;
+	
+	boost::match_results<const char*> m;
+	QElapsedTimer timer;
+	timer.start();
+	try {
+		for (const CorpusRecord& record : corpus.records){
+			if (cancelled)
+				break;
+			const char* itr = record.begin;
+			while(true){
+				++profile.attempts;
+				if (!boost::regex_search(itr,  record.end,  m,  *r,  (itr == record.begin) ? boost::match_default : boost::match_prev_avail))
+					break;
+				++profile.matches;
+				// Guarantee progress on empty matches - without stepping past the end, even transiently
+				if (m[0].second != itr)
+					itr = m[0].second;
+				else if (itr == record.end)
+					break;
+				else
+					++itr;
+			}
+		}
+	} catch (std::runtime_error& e){
+		// e.g. (a*)*b exceeds boost's complexity limit on a long enough line of a's
+		profile.error = QString::fromUtf8(e.what());
+	}
+	profile.ms = timer.nsecsElapsed() / 1000000.0;
+	
+	delete r;
+}
+
+
+GroupProfileDialog::GroupProfileDialog(const std::vector<GroupProfile>& profiles,  QWidget* parent)
+: QDialog(parent)
+{
+	QVBoxLayout* l = new QVBoxLayout;
+	
+	QTableWidget* table = new QTableWidget(profiles.size(),  7,  this);
+	table->setHorizontalHeaderLabels({"Group", "Reason", "Line", "Time (ms)", "Attempts", "Matches", "Regex"});
+	
+	for (size_t i = 0;  i < profiles.size();  ++i){
+		const GroupProfile& p = profiles[i];
+		QTableWidgetItem* items[7];
+		for (auto k = 0;  k < 7;  ++k)
+			items[k] = new QTableWidgetItem;
+		// Numeric columns are set via DisplayRole so that they are sorted numerically, rather than lexicographically
+		items[0]->setData(Qt::DisplayRole,  p.group);
+		items[1]->setText(p.reason);
+		items[2]->setData(Qt::DisplayRole,  p.line);
+		if (!p.error.isEmpty()){
+			items[3]->setText("Failed: " + p.error);
+		} else if (p.compiled){
+			items[3]->setData(Qt::DisplayRole,  p.ms);
+			items[4]->setData(Qt::DisplayRole,  (qulonglong)p.attempts);
+			items[5]->setData(Qt::DisplayRole,  (qulonglong)p.matches);
+		} else {
+			items[3]->setText("Cannot compile in isolation");
+		}
+		items[6]->setText(p.source);
+		for (auto k = 0;  k < 7;  ++k){
+			items[k]->setFlags(items[k]->flags() & ~Qt::ItemIsEditable);
+			table->setItem(i, k, items[k]);
+		}
+	}
+	
+	table->setSortingEnabled(true);
+	table->sortItems(3, Qt::DescendingOrder);
+	table->horizontalHeader()->setStretchLastSection(true);
+	
+	l->addWidget(table);
+	this->setLayout(l);
+	this->setWindowTitle("Group Profile");
+	this->resize(960, 480);
+}
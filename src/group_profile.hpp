@@ -0,0 +1,36 @@
+#ifndef EGIX_GROUP_PROFILE_HPP
+#define EGIX_GROUP_PROFILE_HPP
+
+#include <QDialog>
+#include <QString>
+#include <atomic>
+#include <vector>
+
+
+class Corpus;
+
+
+struct GroupProfile {
+	int group;
+	QString reason;
+	QString source; // The group's (final) regex
+	int line; // Line of the group's opening bracket in the editor
+	int end_line; // Line of its closing bracket
+	bool compiled; // Whether the group's regex is valid in isolation - it will not be if, e.g., it contains a backreference to an outside group
+	double ms;
+	size_t attempts; // Number of regex_search calls
+	size_t matches;
+	QString error; // If matching failed, e.g. because boost's complexity limit was exceeded
+};
+
+
+void profile_group(GroupProfile& profile,  const Corpus& corpus,  const std::atomic<bool>& cancelled); // Thread-safe, so long as corpus is not modified
+
+
+class GroupProfileDialog : public QDialog {
+  public:
+	GroupProfileDialog(const std::vector<GroupProfile>& profiles,  QWidget* parent = nullptr);
+};
+
+
+#endif
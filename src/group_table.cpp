@@ -0,0 +1,87 @@
+#include "group_table.hpp"
+
+
+GroupTable::GroupTable(){
+	this->clear();
+}
+
+void GroupTable::clear(){
+	this->reasons = {"None", "Unspecified"};
+	this->reason2id.clear();
+	this->reason2id.insert("", 1);
+	this->reason.clear();
+	this->open.clear();
+	this->body_start.clear();
+	this->close.clear();
+	this->record_contents.clear();
+}
+
+int GroupTable::intern(const QString& reason_name){
+	const auto it = this->reason2id.constFind(reason_name);
+	if (it != this->reason2id.constEnd())
+		return it.value();
+	const int id = this->reasons.size();
+	this->reasons.push_back(reason_name);
+	this->reason2id.insert(reason_name, id);
+	return id;
+}
+
+int GroupTable::reason_id(const std::vector<QString>& other_reasons,  const int other_reason){
+	return (other_reason < 2) ? other_reason : this->intern(other_reasons[other_reason]);
+}
+
+size_t GroupTable::add(const int _reason,  const bool _record_contents,  const int _open,  const int _body_start){
+	this->reason.push_back(_reason);
+	this->record_contents.push_back(_record_contents);
+	this->open.push_back(_open);
+	this->body_start.push_back(_body_start);
+	this->close.push_back(-1);
+	return this->open.size() - 1;
+}
+
+void GroupTable::truncate(const int dst_end){
+	size_t n = this->open.size();
+	while(n != 0  &&  this->open[n-1] >= dst_end)
+		--n;
+	this->reason.resize(n);
+	this->record_contents.resize(n);
+	this->open.resize(n);
+	this->body_start.resize(n);
+	this->close.resize(n);
+}
+
+size_t GroupTable::size() const {
+	return this->open.size();
+}
+
+QString GroupTable::body(const QString& regex,  const size_t g) const {
+	if (this->close[g] == -1)
+		return QString();
+	return regex.mid(this->body_start[g],  this->close[g] - this->body_start[g]);
+}
+
+QString GroupTable::strip_names(const QString& regex) const {
+	QString s;
+	s.reserve(regex.size());
+	int prev = 0;
+	for (size_t g = 0;  g < this->open.size();  ++g){
+		if (this->reason[g] == 0)
+			continue;
+		s += regex.midRef(prev,  this->open[g] + 1 - prev);
+		prev = this->body_start[g];
+	}
+	s += regex.midRef(prev);
+	return s;
+}
+
+GroupTable GroupTable::slice(const int from,  const int len) const {
+	GroupTable t;
+	for (size_t g = 0;  g < this->open.size();  ++g){
+		if (this->open[g] < from  ||  this->open[g] >= from + len)
+			continue;
+		const size_t h = t.add(t.reason_id(this->reasons,  this->reason[g]),  this->record_contents[g],  this->open[g] - from,  this->body_start[g] - from);
+		if (this->close[g] != -1  &&  this->close[g] < from + len)
+			t.close[h] = this->close[g] - from;
+	}
+	return t;
+}
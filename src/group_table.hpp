@@ -0,0 +1,38 @@
+#ifndef EGIX_GROUP_TABLE_HPP
+#define EGIX_GROUP_TABLE_HPP
+
+#include <QHash>
+#include <QString>
+#include <vector>
+
+
+class GroupTable {
+	/*
+	 * Capture groups of the preprocessor's output, built as the regex is emitted rather than by a second pass over it.
+	 * Stored as a struct of arrays of offsets into the output. Group g here is boost's group g+1.
+	 */
+  public:
+	GroupTable();
+	void clear();
+	int intern(const QString& reason_name);
+	size_t add(const int reason,  const bool record_contents,  const int open,  const int body_start);
+	void truncate(const int dst_end); // Drop groups opening at or after dst_end
+	size_t size() const;
+	QString body(const QString& regex,  const size_t g) const;
+	QString strip_names(const QString& regex) const; // Converts (?P<name>...) groups to (...), for output produced without converting them. Unnamed groups, including (?<name>...) groups, are left as they are.
+	GroupTable slice(const int from,  const int len) const; // The groups opening within [from, from+len), with offsets relative to from
+	int reason_id(const std::vector<QString>& other_reasons,  const int other_reason); // The ID in this table of another table's reason
+	
+	std::vector<QString> reasons; // Interned reason names. 0 is for unnamed groups - including (?<name> and (?'name' groups, whose names are boost's rather than reasons - 1 for groups with an empty name.
+	
+	std::vector<int> reason;
+	std::vector<int> open; // Offset of the opening bracket
+	std::vector<int> body_start; // Offset of the group's contents, i.e. after any (?P<name>, (?<name> or (?'name'
+	std::vector<int> close; // Offset of the closing bracket, or -1 if it has not been found
+	std::vector<bool> record_contents;
+  private:
+	QHash<QString, int> reason2id;
+};
+
+
+#endif
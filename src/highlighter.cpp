@@ -9,6 +9,7 @@
 
 #include <QRegularExpression>
 #include <QTextCharFormat>
+#include <QTimer>
 
 
 #define n_highlighting_rules 12
@@ -34,11 +35,15 @@ static QTextCharFormat highlighting_fmts[n_highlighting_rules+1];
 static const QColor cl_comment(0, 255, 0, 70);
 static const QColor cl_varsub(0, 0, 255, 70);
 static const QColor cl_cyan(0, 255, 255, 70);
+static const int heat_max_alpha = 160;
 
 
 RegexEditorHighlighter::RegexEditorHighlighter(QTextDocument* parent)
 	: QSyntaxHighlighter(parent)
+	, line_heat_revision(0)
 {
+	connect(parent, &QTextDocument::contentsChange, this, &RegexEditorHighlighter::drop_stale_line_heat);
+	
 	int i = 0;
 	highlighting_fmts[++i].setBackground(cl_comment);	// Comment
 	highlighting_fmts[++i].setForeground(Qt::red);	// Escape characters (even number preceding)
@@ -70,4 +75,32 @@ void RegexEditorHighlighter::highlightBlock(const QString& text) {
 			setFormat(match.capturedStart(i), match.capturedLength(i), highlighting_fmts[i]);
 		}
 	}
+	
+	const int block_n = this->currentBlock().blockNumber();
+	if (block_n < 0  ||  block_n >= (int)this->line_heat.size()  ||  this->line_heat[block_n] == 0)
+		return;
+	// Heat is drawn beneath the other rules: it only colours characters without a background of their own
+	const QColor cl_heat(255, 0, 0, (int)(heat_max_alpha * this->line_heat[block_n]));
+	for (auto i = 0;  i < text.size();  ++i){
+		QTextCharFormat fmt = this->format(i);
+		if (fmt.hasProperty(QTextFormat::BackgroundBrush))
+			continue;
+		fmt.setBackground(cl_heat);
+		setFormat(i, 1, fmt);
+	}
+}
+
+void RegexEditorHighlighter::set_line_heat(const std::vector<float>& heat){
+	this->line_heat = heat;
+	this->line_heat_revision = this->document()->revision();
+	this->rehighlight();
+}
+
+void RegexEditorHighlighter::drop_stale_line_heat(){
+	// Reformatting also signals contentsChange, but does not change the revision
+	if (this->line_heat.empty()  ||  this->document()->revision() == this->line_heat_revision)
+		return;
+	this->line_heat.clear();
+	// Not rehighlighted from within the signal, as the document is still being reformatted
+	QTimer::singleShot(0,  this,  &QSyntaxHighlighter::rehighlight);
 }
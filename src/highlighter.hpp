@@ -4,6 +4,7 @@ Based on the example from the official Qt docs: https://doc.qt.io/qt-5/qtwidgets
 
 #include <QSyntaxHighlighter>
 #include <QTextDocument>
+#include <vector>
 
 
 class RegexEditorHighlighter : public QSyntaxHighlighter {
@@ -11,7 +12,12 @@ class RegexEditorHighlighter : public QSyntaxHighlighter {
 	
   public:
 	RegexEditorHighlighter(QTextDocument* parent = 0);
+	void set_line_heat(const std::vector<float>& heat);
 	
   protected:
 	void highlightBlock(const QString& text) override;
+  private:
+	void drop_stale_line_heat();
+	std::vector<float> line_heat; // Per block, from 0 (cold) to 1 (hottest)
+	int line_heat_revision; // Of the document, when line_heat was set. Once the text is edited, the lines no longer correspond to the groups that were profiled.
 };
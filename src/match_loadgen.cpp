@@ -0,0 +1,146 @@
+/*
+ * Load generator for egix-server: several concurrent clients send batches of corpus lines, and the throughput and latency percentiles are reported.
+ *
+ * Usage: egix-loadgen SOCKET_PATH CORPUS_FILE [N_CLIENTS [BATCH_SIZE [N_BATCHES [PATTERN_INDEX]]]]
+ */
+
+#include "match_protocol.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+static
+int connect_to(const char* const socket_path){
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+		return -1;
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path,  socket_path,  sizeof(addr.sun_path) - 1);
+	if (connect(fd,  reinterpret_cast<sockaddr*>(&addr),  sizeof(addr)) != 0){
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+int main(int argc,  char** argv){
+	if (argc < 3){
+		fprintf(stderr,  "Usage: %s SOCKET_PATH CORPUS_FILE [N_CLIENTS [BATCH_SIZE [N_BATCHES [PATTERN_INDEX]]]]\n",  argv[0]);
+		return 1;
+	}
+	const char* const socket_path = argv[1];
+	const unsigned n_clients  = (argc > 3) ? atoi(argv[3]) : 4;
+	const unsigned batch_size = (argc > 4) ? atoi(argv[4]) : 100;
+	const unsigned n_batches  = (argc > 5) ? atoi(argv[5]) : 1000;
+	const uint32_t pattern_indx = (argc > 6) ? atoi(argv[6]) : 0;
+
+	std::vector<std::string> corpus;
+	{
+		std::ifstream f(argv[2]);
+		std::string line;
+		while(std::getline(f, line))
+			corpus.push_back(line);
+	}
+	if (corpus.empty()){
+		fprintf(stderr,  "Empty corpus: %s\n",  argv[2]);
+		return 2;
+	}
+
+	std::vector<double> latencies_ms;
+	size_t n_bytes = 0;
+	size_t n_results = 0;
+	bool failed = false;
+	std::mutex mutex;
+
+	const auto t0 = std::chrono::steady_clock::now();
+	std::vector<std::thread> clients;
+	for (unsigned c = 0;  c < n_clients;  ++c){
+		clients.emplace_back([&, c](){
+			const int fd = connect_to(socket_path);
+			if (fd == -1){
+				std::lock_guard<std::mutex> lock(mutex);
+				failed = true;
+				return;
+			}
+			std::vector<double> my_latencies_ms;
+			size_t my_n_bytes = 0;
+			size_t my_n_results = 0;
+			size_t line_indx = c * batch_size; // Clients start at different points in the corpus
+			for (unsigned b = 0;  b < n_batches;  ++b){
+				std::string request(1, match_protocol::match);
+				match_protocol::append_u32(request, pattern_indx);
+				match_protocol::append_u32(request, batch_size);
+				for (unsigned i = 0;  i < batch_size;  ++i){
+					const std::string& text = corpus[line_indx++ % corpus.size()];
+					match_protocol::append_string(request,  text.data(),  text.size());
+					my_n_bytes += text.size();
+				}
+
+				const auto t_request = std::chrono::steady_clock::now();
+				bool ok = match_protocol::write_all(fd, request.data(), request.size());
+				uint32_t status;
+				ok = ok  &&  match_protocol::read_u32(fd, status);
+				if (ok  &&  status != match_protocol::ok){
+					std::string error;
+					match_protocol::read_string(fd, error);
+					std::lock_guard<std::mutex> lock(mutex);
+					fprintf(stderr,  "Match failed: %s\n",  error.c_str());
+					failed = true;
+					break;
+				}
+				for (unsigned i = 0;  i < batch_size  &&  ok;  ++i){
+					uint32_t n = 0;
+					ok = match_protocol::read_u32(fd, n);
+					my_n_results += n;
+					for (uint32_t k = 0;  k < 3*n  &&  ok;  ++k){
+						uint32_t dummy;
+						ok = match_protocol::read_u32(fd, dummy);
+					}
+				}
+				if (!ok){
+					std::lock_guard<std::mutex> lock(mutex);
+					failed = true;
+					break;
+				}
+				my_latencies_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_request).count());
+			}
+			close(fd);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			latencies_ms.insert(latencies_ms.end(),  my_latencies_ms.begin(),  my_latencies_ms.end());
+			n_bytes += my_n_bytes;
+			n_results += my_n_results;
+		});
+	}
+	for (std::thread& client : clients)
+		client.join();
+	const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	if (failed)
+		fprintf(stderr,  "WARNING: Some requests failed - is egix-server running on %s, and does pattern %u exist?\n",  socket_path,  pattern_indx);
+	if (latencies_ms.empty())
+		return 3;
+
+	std::sort(latencies_ms.begin(), latencies_ms.end());
+	auto percentile = [&](const double p){
+		return latencies_ms[std::min<size_t>(latencies_ms.size() - 1,  p * latencies_ms.size())];
+	};
+	const size_t n_texts = latencies_ms.size() * batch_size;
+	printf("%u clients, %zu batches of %u texts in %.3fs\n",  n_clients,  latencies_ms.size(),  batch_size,  elapsed_s);
+	printf("Throughput:\t%.0f texts/s\t%.2f MiB/s\t%zu named group results\n",  n_texts / elapsed_s,  n_bytes / elapsed_s / (1024*1024),  n_results);
+	printf("Batch latency (ms):\tp50 %.3f\tp90 %.3f\tp99 %.3f\tmax %.3f\n",  percentile(0.5),  percentile(0.9),  percentile(0.99),  latencies_ms.back());
+
+	return failed ? 3 : 0;
+}
@@ -0,0 +1,95 @@
+#ifndef EGIX_MATCH_PROTOCOL_HPP
+#define EGIX_MATCH_PROTOCOL_HPP
+
+/*
+ * Wire format shared by egix-server and egix-loadgen. All integers are little-endian uint32, all strings are length-prefixed.
+ *
+ * Request:  'L'
+ * Response: n_patterns, then for each pattern: name, n_reasons, reason names..., n_groups, reason index of each group (starting at group 1)
+ *
+ * Request:  'M', pattern index, n_texts, texts...
+ * Response: status. If status is ok: for each text: n_results, then for each named group matched: reason index, start offset, end offset. If status is failed - e.g. boost gave up on a text as too complex to match - an error message.
+ */
+
+#include <algorithm> // for std::min
+#include <cstdint>
+#include <cstring> // for memcpy
+#include <string>
+#include <unistd.h> // for read, write
+
+
+namespace match_protocol {
+
+constexpr static const char list_patterns = 'L';
+constexpr static const char match = 'M';
+constexpr static const uint32_t max_request_sz = 256 * 1024 * 1024; // Guards the server against malformed requests
+constexpr static const uint32_t max_texts = 1024 * 1024; // Per request, as each costs memory even if empty
+
+constexpr static const uint32_t ok = 0;
+constexpr static const uint32_t failed = 1;
+
+inline
+bool read_all(const int fd,  void* const buf,  const size_t n){
+	size_t done = 0;
+	while(done != n){
+		const ssize_t r = read(fd,  reinterpret_cast<char*>(buf) + done,  n - done);
+		if (r <= 0)
+			return false;
+		done += r;
+	}
+	return true;
+}
+
+inline
+bool write_all(const int fd,  const void* const buf,  const size_t n){
+	size_t done = 0;
+	while(done != n){
+		const ssize_t r = write(fd,  reinterpret_cast<const char*>(buf) + done,  n - done);
+		if (r <= 0)
+			return false;
+		done += r;
+	}
+	return true;
+}
+
+inline
+bool read_u32(const int fd,  uint32_t& n){
+	unsigned char b[4];
+	if (!read_all(fd, b, 4))
+		return false;
+	n = (uint32_t)b[0]  |  ((uint32_t)b[1] << 8)  |  ((uint32_t)b[2] << 16)  |  ((uint32_t)b[3] << 24);
+	return true;
+}
+
+inline
+bool read_string(const int fd,  std::string& s){
+	uint32_t n;
+	if (!read_u32(fd, n)  ||  n > max_request_sz)
+		return false;
+	// Grown as the data arrives, so that a malformed length costs no more memory than was actually sent
+	s.clear();
+	while(s.size() != n){
+		const size_t done = s.size();
+		s.resize(done + std::min<size_t>(n - done,  64 * 1024));
+		if (!read_all(fd,  &s[done],  s.size() - done))
+			return false;
+	}
+	return true;
+}
+
+inline
+void append_u32(std::string& buf,  const uint32_t n){
+	const char b[4] = {(char)(n & 0xff),  (char)((n >> 8) & 0xff),  (char)((n >> 16) & 0xff),  (char)((n >> 24) & 0xff)};
+	buf.append(b, 4);
+}
+
+inline
+void append_string(std::string& buf,  const char* const s,  const uint32_t n){
+	append_u32(buf, n);
+	buf.append(s, n);
+}
+
+} // namespace match_protocol
+
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * Local match server: compiles each (final, e.g. 'Strip'ped or 'Set') regex file once, and serves batched match requests over a Unix domain socket, so that worker processes need not each compile and hold their own copy.
+ *
+ * Usage: egix-server SOCKET_PATH REGEX_FILE [REGEX_FILE...]
+ * Set EGIX_SERVER_THREADS to override the size of the worker pool.
+ */
+
+#include "match_protocol.hpp"
+
+#include <compsky/regex/named_groups.hpp>
+
+#include <boost/regex.hpp>
+
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+struct Pattern {
+	std::string name;
+	std::vector<std::string> reasons;
+	std::vector<uint32_t> group2reason; // Index 0 is the whole match
+	boost::basic_regex<char, boost::cpp_regex_traits<char>>* regex;
+};
+
+
+class WorkerPool {
+  public:
+	explicit WorkerPool(const unsigned n_threads){
+		for (unsigned i = 0;  i < n_threads;  ++i)
+			this->threads.emplace_back([this](){
+				while(true){
+					std::function<void()> job;
+					{
+						std::unique_lock<std::mutex> lock(this->mutex);
+						this->cv.wait(lock,  [this](){ return !this->jobs.empty(); });
+						job = std::move(this->jobs.front());
+						this->jobs.pop();
+					}
+					job();
+				}
+			});
+	}
+	void push(std::function<void()> job){
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->jobs.push(std::move(job));
+		}
+		this->cv.notify_one();
+	}
+	size_t size() const {
+		return this->threads.size();
+	}
+  private:
+	std::vector<std::thread> threads;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable cv;
+};
+
+
+static std::vector<Pattern> patterns;
+static WorkerPool* pool;
+
+
+static
+bool load_pattern(const char* const file_path,  Pattern& pattern){
+	std::ifstream f(file_path);
+	if (!f)
+		return false;
+	std::stringstream ss;
+	ss << f.rdbuf();
+	std::string buf = ss.str();
+	char* const s = &buf[0];
+
+	char none[] = "None";
+	char unspecified[] = "Unspecified";
+	std::vector<char*> reason_name2id = {none, unspecified};
+	std::vector<int> groupindx2reason;
+	std::vector<char*> group_starts;
+	std::vector<char*> group_ends;
+	std::vector<bool> record_contents;
+
+	compsky::regex::convert_named_groups(s,  s,  reason_name2id,  groupindx2reason, record_contents, group_starts, group_ends);
+
+	pattern.name = file_path;
+	for (const char* const reason : reason_name2id)
+		pattern.reasons.emplace_back(reason);
+	for (const int reason : groupindx2reason)
+		pattern.group2reason.push_back(reason);
+	try {
+		pattern.regex = new boost::basic_regex<char, boost::cpp_regex_traits<char>>(s,  boost::regex::perl);
+	} catch (boost::regex_error& e){
+		fprintf(stderr,  "%s: %s\n",  file_path,  e.what());
+		return false;
+	}
+	return true;
+}
+
+
+static
+void match_text(const Pattern& pattern,  const std::string& text,  std::string& out){
+	std::string results;
+	uint32_t n_results = 0;
+	const char* const begin = text.data();
+	typedef boost::regex_iterator<const char*,  char,  boost::cpp_regex_traits<char>> Iterator;
+	const Iterator end;
+	for (Iterator it(begin,  begin + text.size(),  *pattern.regex);  it != end;  ++it){
+		const boost::match_results<const char*>& m = *it;
+		for (size_t g = 1;  g < m.size();  ++g){
+			if (!m[g].matched)
+				continue;
+			match_protocol::append_u32(results,  (g < pattern.group2reason.size()) ? pattern.group2reason[g] : 0);
+			match_protocol::append_u32(results,  m[g].first - begin);
+			match_protocol::append_u32(results,  m[g].second - begin);
+			++n_results;
+		}
+	}
+	match_protocol::append_u32(out, n_results);
+	out += results;
+}
+
+
+static
+bool serve_match(const int fd){
+	uint32_t pattern_indx;
+	uint32_t n_texts;
+	if (!match_protocol::read_u32(fd, pattern_indx)  ||  !match_protocol::read_u32(fd, n_texts))
+		return false;
+	if (pattern_indx >= patterns.size()  ||  n_texts > match_protocol::max_texts)
+		return false;
+
+	std::vector<std::string> texts;
+	texts.reserve(std::min<uint32_t>(n_texts, 1024)); // Grown as the texts arrive, rather than trusting n_texts
+	size_t total_sz = 0;
+	for (uint32_t i = 0;  i < n_texts;  ++i){
+		texts.emplace_back();
+		if (!match_protocol::read_string(fd, texts.back()))
+			return false;
+		if ((total_sz += texts.back().size()) > match_protocol::max_request_sz)
+			return false;
+	}
+
+	// The batch is split into one contiguous slice per worker
+	const Pattern& pattern = patterns[pattern_indx];
+	std::vector<std::string> outputs(n_texts);
+	const size_t n_slices = std::min<size_t>(pool->size(),  n_texts);
+	size_t n_slices_remaining = n_slices;
+	std::string error;
+	std::mutex mutex;
+	std::condition_variable cv;
+	for (size_t k = 0;  k < n_slices;  ++k){
+		pool->push([&, k](){
+			std::string slice_error;
+			try {
+				for (size_t i = k * n_texts / n_slices;  i < (k + 1) * n_texts / n_slices;  ++i)
+					match_text(pattern,  texts[i],  outputs[i]);
+			} catch (std::runtime_error& e){
+				// e.g. boost gives up on a text as too complex to match. Only this request fails - an exception escaping a worker would take down the server.
+				slice_error = e.what();
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!slice_error.empty())
+				error = slice_error;
+			if (--n_slices_remaining == 0)
+				cv.notify_one();
+		});
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock,  [&](){ return n_slices_remaining == 0; });
+	}
+
+	std::string response;
+	if (!error.empty()){
+		match_protocol::append_u32(response, match_protocol::failed);
+		match_protocol::append_string(response,  error.data(),  error.size());
+	} else {
+		match_protocol::append_u32(response, match_protocol::ok);
+		for (const std::string& output : outputs)
+			response += output;
+	}
+	return match_protocol::write_all(fd, response.data(), response.size());
+}
+
+
+static
+bool serve_list(const int fd){
+	std::string response;
+	match_protocol::append_u32(response, patterns.size());
+	for (const Pattern& pattern : patterns){
+		match_protocol::append_string(response,  pattern.name.data(),  pattern.name.size());
+		match_protocol::append_u32(response, pattern.reasons.size());
+		for (const std::string& reason : pattern.reasons)
+			match_protocol::append_string(response,  reason.data(),  reason.size());
+		const uint32_t n_groups = (pattern.group2reason.empty()) ? 0 : pattern.group2reason.size() - 1;
+		match_protocol::append_u32(response, n_groups);
+		for (uint32_t g = 1;  g <= n_groups;  ++g)
+			match_protocol::append_u32(response, pattern.group2reason[g]);
+	}
+	return match_protocol::write_all(fd, response.data(), response.size());
+}
+
+
+static
+void serve_connection(const int fd){
+	while(true){
+		char request_type;
+		if (!match_protocol::read_all(fd, &request_type, 1))
+			break;
+		bool ok = false;
+		switch(request_type){
+			case match_protocol::list_patterns:
+				ok = serve_list(fd);
+				break;
+			case match_protocol::match:
+				ok = serve_match(fd);
+				break;
+		}
+		if (!ok)
+			break;
+	}
+	close(fd);
+}
+
+
+int main(int argc,  char** argv){
+	if (argc < 3){
+		fprintf(stderr,  "Usage: %s SOCKET_PATH REGEX_FILE [REGEX_FILE...]\n",  argv[0]);
+		return 1;
+	}
+
+	patterns.resize(argc - 2);
+	for (int i = 2;  i < argc;  ++i){
+		if (!load_pattern(argv[i], patterns[i-2])){
+			fprintf(stderr,  "Cannot load pattern: %s\n",  argv[i]);
+			return 2;
+		}
+	}
+
+	const char* const n_threads_env = getenv("EGIX_SERVER_THREADS");
+	const unsigned n_threads = (n_threads_env != nullptr) ? atoi(n_threads_env) : std::thread::hardware_concurrency();
+	pool = new WorkerPool((n_threads == 0) ? 1 : n_threads);
+
+	signal(SIGPIPE, SIG_IGN); // A client disconnecting mid-response must not kill the server
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == -1){
+		perror("socket");
+		return 3;
+	}
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (strlen(argv[1]) >= sizeof(addr.sun_path)){
+		fprintf(stderr,  "Socket path too long: %s\n",  argv[1]);
+		return 3;
+	}
+	strcpy(addr.sun_path, argv[1]);
+	unlink(argv[1]);
+	if (bind(listener,  reinterpret_cast<sockaddr*>(&addr),  sizeof(addr)) != 0  ||  listen(listener, 64) != 0){
+		perror("bind");
+		return 3;
+	}
+
+	fprintf(stderr,  "Serving %zu patterns on %s with %zu workers\n",  patterns.size(),  argv[1],  pool->size());
+
+	while(true){
+		const int fd = accept(listener, nullptr, nullptr);
+		if (fd == -1)
+			continue;
+		std::thread(serve_connection, fd).detach();
+	}
+}
@@ -0,0 +1,119 @@
+#include "optimisation_choice.hpp"
+#include "corpus.hpp"
+
+#include <boost/regex.hpp>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+
+constexpr static const size_t max_sample_sz = 2000; // Records
+constexpr static const int n_rounds = 3;
+
+
+static
+double time_searches(const boost::basic_regex<char, boost::cpp_regex_traits<char>>& r,  const std::vector<CorpusRecord>& sample){
+	QElapsedTimer timer;
+	timer.start();
+	try {
+		for (const CorpusRecord& record : sample)
+			boost::regex_search(record.begin,  record.end,  r);
+	} catch (std::runtime_error&){
+		// Boost gave up on a record, e.g. it ran out of stack space - so this form is the slower one, however long it took to fail
+		return std::numeric_limits<double>::infinity();
+	}
+	return timer.nsecsElapsed() / 1000000.0;
+}
+
+
+void benchmark_group_forms(const QString& original,  const Corpus& corpus,  OptimisationChoice& choice){
+	// Falls back to the optimised form - i.e. the behaviour of plain 'Optimise' - if the group cannot be measured in isolation, e.g. if it contains a backreference
+	choice.use_optimised = true;
+	choice.original_ms = -1;
+	choice.optimised_ms = -1;
+	
+	std::vector<CorpusRecord> sample;
+	const size_t step = corpus.records.size() / max_sample_sz + 1;
+	for (size_t i = 0;  i < corpus.records.size();  i += step)
+		sample.push_back(corpus.records[i]);
+	if (sample.empty())
+		return;
+	
+	const QByteArray forms[2] = {original.toLocal8Bit(),  choice.optimised.toLocal8Bit()};
+	boost::basic_regex<char, boost::cpp_regex_traits<char>> r[2];
+	try {
+		for (auto k = 0;  k < 2;  ++k)
+			r[k].assign(forms[k].constData(),  boost::regex::perl);
+	} catch (boost::regex_error& e){
+		return;
+	}
+	
+	// Alternate between the forms, keeping the fastest round of each, to reduce the effect of noise and of cache warm-up
+	double ms[2] = {-1, -1};
+	for (auto round = 0;  round < n_rounds;  ++round){
+		for (auto k = 0;  k < 2;  ++k){
+			if (std::isinf(ms[k]))
+				// No later round can do better than giving up
+				continue;
+			const double t = time_searches(r[k], sample);
+			if (ms[k] < 0  ||  t < ms[k])
+				ms[k] = t;
+		}
+	}
+	choice.original_ms = ms[0];
+	choice.optimised_ms = ms[1];
+	choice.use_optimised = (ms[1] <= ms[0]);
+}
+
+
+OptimisationChoices::OptimisationChoices(const QString& _file_path)
+: file_path(_file_path)
+{
+	QFile f(this->file_path);
+	if (!f.open(QIODevice::ReadOnly))
+		return;
+	// key, use_optimised, original_ms, optimised_ms, optimised (percent-encoded)
+	for (const QByteArray& line : f.readAll().split('\n')){
+		const QList<QByteArray> fields = line.split('\t');
+		if (fields.size() != 5)
+			continue;
+		OptimisationChoice choice;
+		choice.use_optimised = (fields[1] == "1");
+		choice.original_ms = fields[2].toDouble();
+		choice.optimised_ms = fields[3].toDouble();
+		choice.optimised = QString::fromUtf8(QByteArray::fromPercentEncoding(fields[4]));
+		this->choices.insert(fields[0], choice); // Later lines supersede earlier ones
+	}
+	f.close();
+}
+
+QByteArray OptimisationChoices::key(const QString& group,  const Corpus& corpus){
+	const QFileInfo corpus_info(corpus.file_path());
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(corpus_info.absoluteFilePath().toUtf8());
+	hash.addData(QByteArray::number(corpus_info.size()) + "\t" + QByteArray::number(corpus_info.lastModified().toMSecsSinceEpoch()) + "\t");
+	hash.addData(group.toUtf8());
+	return hash.result().toHex();
+}
+
+const OptimisationChoice* OptimisationChoices::find(const QString& group,  const Corpus& corpus) const {
+	const auto it = this->choices.constFind(key(group, corpus));
+	return (it == this->choices.constEnd()) ? nullptr : &it.value();
+}
+
+const OptimisationChoice* OptimisationChoices::insert(const QString& group,  const Corpus& corpus,  const OptimisationChoice& choice){
+	const QByteArray k = key(group, corpus);
+	QFile f(this->file_path);
+	if (f.open(QIODevice::WriteOnly | QIODevice::Append)){
+		f.write(k + "\t" + ((choice.use_optimised) ? "1" : "0") + "\t" + QByteArray::number(choice.original_ms) + "\t" + QByteArray::number(choice.optimised_ms) + "\t" + choice.optimised.toUtf8().toPercentEncoding() + "\n");
+		f.close();
+	}
+	return &this->choices.insert(k, choice).value();
+}
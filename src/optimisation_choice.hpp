@@ -0,0 +1,39 @@
+#ifndef EGIX_OPTIMISATION_CHOICE_HPP
+#define EGIX_OPTIMISATION_CHOICE_HPP
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+
+class Corpus;
+
+
+struct OptimisationChoice {
+	QString optimised; // regopt.pl's output, so that cached choices need not rerun it
+	bool use_optimised;
+	double original_ms; // -1 if either form could not be compiled in isolation; infinity if boost gave up searching the sample with it
+	double optimised_ms;
+};
+
+
+void benchmark_group_forms(const QString& original,  const Corpus& corpus,  OptimisationChoice& choice);
+
+
+class OptimisationChoices {
+	/*
+	 * Choices made by the 'Optimise if faster' mode, persisted so that later builds reuse them rather than re-measuring.
+	 * Each choice is specific to a group's text and the corpus it was measured against.
+	 */
+  public:
+	explicit OptimisationChoices(const QString& _file_path);
+	const OptimisationChoice* find(const QString& group,  const Corpus& corpus) const;
+	const OptimisationChoice* insert(const QString& group,  const Corpus& corpus,  const OptimisationChoice& choice);
+  private:
+	static QByteArray key(const QString& group,  const Corpus& corpus);
+	QHash<QByteArray, OptimisationChoice> choices;
+	const QString file_path;
+};
+
+
+#endif
@@ -0,0 +1,149 @@
+#include "pattern_set.hpp"
+#include "group_table.hpp"
+
+#include <algorithm>
+
+
+static
+int read_number(const QString& regex,  int& i){
+	// Returns -1 if there are no digits at i
+	int n = -1;
+	while(i < regex.size()  &&  regex.at(i).isDigit()){
+		n = ((n == -1) ? 0 : 10 * n) + regex.at(i).digitValue();
+		++i;
+	}
+	return n;
+}
+
+
+static
+bool renumber_group_refs(const QString& regex,  const int offset,  QString& renumbered,  QString& error){
+	// Shifts the absolute group numbers used by backreferences, subroutine calls and conditionals, as the groups of earlier sources precede this source's groups in the combined regex. Relative and named references are unaffected.
+	renumbered.clear();
+	renumbered.reserve(regex.size());
+	int set_len = -1; // Number of characters within the current [...] set, or -1 if outside of one
+	for (int i = 0;  i < regex.size();  ){
+		const QChar c = regex.at(i);
+		if (c == QChar('\\')  &&  i + 1 < regex.size()){
+			const QChar next = regex.at(i + 1);
+			if (set_len == -1  &&  next.isDigit()  &&  next != QChar('0')){
+				// \N is always emitted as \g{N}, as e.g. \1 followed by a literal 0 would otherwise become ambiguous
+				int k = i + 1;
+				renumbered += QString("\\g{%1}").arg(read_number(regex, k) + offset);
+				i = k;
+				continue;
+			}
+			if (set_len == -1  &&  next == QChar('g')){
+				int k = i + 2;
+				const bool braced = (k < regex.size()  &&  regex.at(k) == QChar('{'));
+				if (braced)
+					++k;
+				const int n = read_number(regex, k);
+				if (n != -1  &&  (!braced  ||  (k < regex.size()  &&  regex.at(k) == QChar('}')))){
+					renumbered += QString("\\g{%1}").arg(n + offset);
+					i = k + braced;
+					continue;
+				}
+			}
+			if (next == QChar('Q')){
+				// Quoted literal text
+				const int end = regex.indexOf("\\E",  i + 2);
+				const int quote_end = (end == -1) ? regex.size() : end + 2;
+				renumbered += regex.midRef(i,  quote_end - i);
+				i = quote_end;
+				continue;
+			}
+			renumbered += c;
+			renumbered += next;
+			i += 2;
+			if (set_len != -1)
+				++set_len;
+			continue;
+		}
+		if (set_len != -1){
+			if (c == QChar(']')  &&  set_len != 0)
+				set_len = -1;
+			else if (!(c == QChar('^')  &&  set_len == 0  &&  regex.at(i - 1) == QChar('[')))
+				++set_len;
+			renumbered += c;
+			++i;
+			continue;
+		}
+		if (c == QChar('[')){
+			set_len = 0;
+			renumbered += c;
+			++i;
+			continue;
+		}
+		if (c == QChar('(')  &&  regex.midRef(i + 1,  1) == QLatin1String("?")){
+			int k = i + 2;
+			const bool conditional = (regex.midRef(k, 1) == QLatin1String("("));
+			if (conditional)
+				++k;
+			if (regex.midRef(k, 1) == QLatin1String("R")  ||  regex.midRef(k, 2) == QLatin1String("0)")){
+				error = "Recursion of the whole regex, with (?R) or (?0), would recurse into the other sources of the set";
+				return false;
+			}
+			const int group_start = k;
+			const int n = read_number(regex, k);
+			if (n != -1  &&  regex.midRef(k, 1) == QLatin1String(")")){
+				renumbered += regex.midRef(i,  group_start - i);
+				renumbered += QString::number(n + offset);
+				i = k;
+				continue;
+			}
+		}
+		renumbered += c;
+		++i;
+	}
+	return true;
+}
+
+
+bool PatternSet::add(const QString& file_path,  const QString& final_regex,  const GroupTable& groups,  QString& error){
+	const int n = groups.size();
+	
+	QString renumbered;
+	QString renumbered_converted;
+	if (!renumber_group_refs(final_regex,  this->n_groups,  renumbered,  error))
+		return false;
+	renumber_group_refs(groups.strip_names(final_regex),  this->n_groups,  renumbered_converted,  error);
+	
+	if (!this->sources.empty()){
+		this->combined += "|";
+		this->combined_converted += "|";
+	}
+	this->combined += "(?:";
+	this->combined += renumbered;
+	this->combined += ")";
+	this->combined_converted += "(?:";
+	this->combined_converted += renumbered_converted;
+	this->combined_converted += ")";
+	
+	if (this->group_reasons.empty())
+		this->group_reasons.push_back(QString());
+	for (const int reason : groups.reason)
+		this->group_reasons.push_back(groups.reasons[reason]);
+	
+	this->sources.push_back({file_path,  this->n_groups + 1 /* Group 0 is the whole match */,  n});
+	this->n_groups += n;
+	return true;
+}
+
+const PatternSetSource* PatternSet::source_of_group(const int group_indx) const {
+	// Binary search, as the sources are ordered by first_group
+	auto it = std::upper_bound(
+		this->sources.begin(),
+		this->sources.end(),
+		group_indx,
+		[](const int indx,  const PatternSetSource& src){
+			return indx < src.first_group;
+		}
+	);
+	if (it == this->sources.begin())
+		return nullptr;
+	--it;
+	if (group_indx >= it->first_group + it->n_groups)
+		return nullptr;
+	return &*it;
+}
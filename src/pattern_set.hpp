@@ -0,0 +1,32 @@
+#ifndef EGIX_PATTERN_SET_HPP
+#define EGIX_PATTERN_SET_HPP
+
+#include <QString>
+#include <vector>
+
+
+class GroupTable;
+
+
+struct PatternSetSource {
+	QString file_path;
+	int first_group; // Boost index of the first capture group originating from this source
+	int n_groups;
+};
+
+
+class PatternSet {
+  public:
+	bool add(const QString& file_path,  const QString& final_regex,  const GroupTable& groups,  QString& error); // final_regex must retain its group names, and groups must be its group table. Its numbered group references are shifted past the groups of the earlier sources. Returns false, setting error, if it cannot be combined with them.
+	const PatternSetSource* source_of_group(const int group_indx) const;
+	
+	QString combined; // Single alternation of every source, in the order they were added. Boost's alternation is leftmost-first, so at each position only the first source that matches there is reported: a later source whose match starts at the same position - even a longer one - is not, and nor is any match that starts within the reported one. Sources whose matches may overlap, and must all be found, need separate passes.
+	QString combined_converted; // As combined, but with the group names stripped, for boost
+	std::vector<QString> group_reasons; // Reason name of each capture group; index 0 is the whole match
+	std::vector<PatternSetSource> sources;
+  private:
+	int n_groups = 0;
+};
+
+
+#endif
@@ -0,0 +1,284 @@
+#include "preview_pane.hpp"
+#include "corpus.hpp"
+#include "egix/dfa.hpp"
+
+#include <boost/regex.hpp>
+
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextEdit>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <functional>
+
+
+constexpr static const size_t max_matches = 200;
+constexpr static const int frame_budget_ms = 8;
+constexpr static const unsigned max_threads = 4;
+
+
+struct PreviewMatch {
+	size_t record;
+	std::vector<std::pair<int, int>> spans; // Offsets within the record of the whole match (index 0) and of each capture group, or {-1, -1} if the group did not participate
+};
+
+struct PreviewSlice {
+	size_t begin;
+	size_t end;
+	std::vector<PreviewMatch> matches;
+	QString error;
+};
+
+struct PreviewRun {
+	uint64_t generation;
+	const Corpus* corpus;
+	std::atomic<bool> cancelled;
+	std::atomic<bool> failed; // A slice has failed, so the others may as well stop
+	std::atomic<bool> finished; // The coordinator has nothing left to do, so can be joined without waiting
+	QByteArray regex;
+	boost::basic_regex<char, boost::cpp_regex_traits<char>> compiled;
+	std::unique_ptr<const Dfa> prefilter; // If the regex can be compiled to a DFA, it rejects the records without a match far faster than boost can
+	std::vector<PreviewSlice> slices;
+	std::vector<PreviewMatch> matches; // Merged from the slices, in corpus order
+	QString error;
+	double ms;
+};
+
+
+PreviewPane::PreviewPane(QWidget* parent)
+: QWidget(parent)
+, corpus(nullptr)
+, generation(0)
+, n_rendered(0)
+{
+	QVBoxLayout* l = new QVBoxLayout;
+	l->setContentsMargins(0, 0, 0, 0);
+	
+	this->status = new QLabel("Load a corpus to preview matches", this);
+	l->addWidget(this->status);
+	
+	this->view = new QTextEdit(this);
+	this->view->setReadOnly(true);
+	this->view->setLineWrapMode(QTextEdit::NoWrap);
+	QFont font;
+	font.setStyleHint(QFont::Monospace);
+	font.setFixedPitch(true);
+	this->view->setFont(font);
+	l->addWidget(this->view);
+	
+	this->render_timer = new QTimer(this);
+	this->render_timer->setInterval(0);
+	connect(this->render_timer, &QTimer::timeout, this, &PreviewPane::render_some);
+	
+	this->setLayout(l);
+}
+
+PreviewPane::~PreviewPane(){
+	this->cancel();
+	this->reap(true);
+}
+
+void PreviewPane::cancel(){
+	// Does not wait for the run to stop - a single record can take a long time to match - so never blocks typing
+	++this->generation;
+	this->render_timer->stop();
+	if (this->current != nullptr){
+		this->current->cancelled = true;
+		if (this->coordinator.joinable())
+			this->retired.emplace_back(std::move(this->coordinator),  this->current);
+	}
+	this->current.reset();
+	this->reap(false);
+}
+
+void PreviewPane::reap(const bool wait){
+	// Joins the coordinators of cancelled runs that have finished, or of all of them if wait is set
+	for (auto it = this->retired.begin();  it != this->retired.end();  ){
+		if (wait  ||  it->second->finished){
+			it->first.join();
+			it = this->retired.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void PreviewPane::set_corpus(const Corpus* _corpus){
+	this->cancel();
+	this->reap(true); // The previous corpus is about to be deleted, so no run may still be reading it
+	this->corpus = _corpus;
+}
+
+void PreviewPane::show_status(const QString& msg){
+	this->cancel();
+	this->status->setText(msg);
+}
+
+void PreviewPane::run(const QByteArray& regex,  const std::vector<QString>& _group_names){
+	if (this->corpus == nullptr){
+		this->show_status("Load a corpus to preview matches");
+		return;
+	}
+	this->cancel();
+	this->group_names = _group_names;
+	this->status->setText("Matching...");
+	
+	std::shared_ptr<PreviewRun> run_state = std::make_shared<PreviewRun>();
+	run_state->generation = this->generation;
+	run_state->corpus = this->corpus;
+	run_state->cancelled = false;
+	run_state->failed = false;
+	run_state->finished = false;
+	run_state->regex = regex;
+	this->current = run_state;
+	this->coordinator = std::thread(&PreviewPane::search, this, run_state);
+}
+
+void PreviewPane::search(const std::shared_ptr<PreviewRun> run_state){
+	// Runs on the coordinator thread
+	QElapsedTimer timer;
+	timer.start();
+	try {
+		run_state->compiled.assign(run_state->regex.constData(),  boost::regex::perl);
+	} catch (boost::regex_error& e){
+		run_state->error = QString("Invalid regex: ") + e.what();
+	}
+	if (run_state->error.isEmpty()){
+		std::string why_not;
+		run_state->prefilter.reset(Dfa::compile(run_state->regex.constData(),  why_not)); // Otherwise boost searches every record
+	}
+	
+	if (run_state->error.isEmpty()){
+		const size_t n_records = run_state->corpus->records.size();
+		const unsigned n_threads = std::max(1u,  std::min(max_threads,  std::thread::hardware_concurrency()));
+		run_state->slices.resize(n_threads);
+		for (unsigned k = 0;  k < n_threads;  ++k){
+			run_state->slices[k].begin = k * n_records / n_threads;
+			run_state->slices[k].end = (k + 1) * n_records / n_threads;
+		}
+		std::vector<std::thread> helpers;
+		for (unsigned k = 1;  k < n_threads;  ++k)
+			helpers.emplace_back(&PreviewPane::search_slice, this, std::ref(*run_state), k);
+		this->search_slice(*run_state, 0);
+		for (std::thread& helper : helpers)
+			helper.join();
+		
+		for (const PreviewSlice& slice : run_state->slices)
+			if (run_state->error.isEmpty()  &&  !slice.error.isEmpty())
+				run_state->error = slice.error;
+		for (PreviewSlice& slice : run_state->slices){
+			for (PreviewMatch& m : slice.matches){
+				if (run_state->matches.size() == max_matches)
+					break;
+				run_state->matches.push_back(std::move(m));
+			}
+		}
+	}
+	run_state->ms = timer.nsecsElapsed() / 1000000.0;
+	
+	if (!run_state->cancelled){
+		const uint64_t run_generation = run_state->generation;
+		QMetaObject::invokeMethod(this,  [this, run_generation](){ this->deliver(run_generation); },  Qt::QueuedConnection);
+	}
+	run_state->finished = true;
+}
+
+void PreviewPane::search_slice(PreviewRun& run_state,  const size_t slice_indx){
+	PreviewSlice& slice = run_state.slices[slice_indx];
+	typedef boost::regex_iterator<const char*,  char,  boost::cpp_regex_traits<char>> Iterator;
+	const Iterator end;
+	size_t i = slice.begin;
+	try {
+		for (;  i < slice.end;  ++i){
+			if (slice.matches.size() == max_matches)
+				return;
+			const CorpusRecord& record = run_state.corpus->records[i];
+			if (run_state.prefilter != nullptr  &&  !run_state.prefilter->search(record.begin,  record.end))
+				continue;
+			for (Iterator it(record.begin,  record.end,  run_state.compiled);  it != end  &&  slice.matches.size() != max_matches;  ++it){
+				if (run_state.cancelled  ||  run_state.failed)
+					return;
+				const boost::match_results<const char*>& m = *it;
+				PreviewMatch match;
+				match.record = i;
+				for (size_t g = 0;  g < m.size();  ++g){
+					if (m[g].matched)
+						match.spans.emplace_back(m[g].first - record.begin,  m[g].second - record.begin);
+					else
+						match.spans.emplace_back(-1, -1);
+				}
+				slice.matches.push_back(std::move(match));
+			}
+			if (run_state.cancelled  ||  run_state.failed)
+				return;
+		}
+	} catch (std::runtime_error& e){
+		// e.g. boost gives up on a regex that is too complex to match
+		slice.error = QString("Cannot match record %1: %2").arg(i + 1).arg(e.what());
+		run_state.failed = true;
+	}
+}
+
+void PreviewPane::deliver(const uint64_t _generation){
+	// Runs on the GUI thread
+	if (_generation != this->generation  ||  this->current == nullptr)
+		return;
+	if (this->coordinator.joinable())
+		this->coordinator.join(); // Already finished, as it has posted its results
+	
+	if (!this->current->error.isEmpty()){
+		this->status->setText(this->current->error);
+		this->view->clear();
+		this->current.reset();
+		return;
+	}
+	this->status->setText(QString("%1%2 matches (%3ms)").arg(this->current->matches.size()).arg((this->current->matches.size() == max_matches) ? "+" : "").arg(this->current->ms));
+	this->view->clear();
+	this->n_rendered = 0;
+	this->render_timer->start();
+}
+
+void PreviewPane::render_some(){
+	if (this->current == nullptr  ||  this->n_rendered == this->current->matches.size()){
+		this->render_timer->stop();
+		return;
+	}
+	
+	QTextCharFormat plain_format;
+	QTextCharFormat record_indx_format;
+	record_indx_format.setForeground(Qt::gray);
+	QTextCharFormat match_format;
+	match_format.setBackground(Qt::yellow);
+	QTextCharFormat group_name_format;
+	group_name_format.setForeground(Qt::blue);
+	group_name_format.setFontWeight(QFont::Bold);
+	
+	QTextCursor cursor(this->view->document());
+	cursor.movePosition(QTextCursor::End);
+	QElapsedTimer timer;
+	timer.start();
+	while(this->n_rendered != this->current->matches.size()  &&  timer.elapsed() < frame_budget_ms){
+		const PreviewMatch& m = this->current->matches[this->n_rendered++];
+		const CorpusRecord& record = this->corpus->records[m.record];
+		const QByteArray text(record.begin,  record.end - record.begin);
+		
+		if (this->n_rendered != 1)
+			cursor.insertText("\n", plain_format);
+		cursor.insertText(QString("%1:\t").arg(m.record + 1),  record_indx_format);
+		cursor.insertText(QString::fromLocal8Bit(text.left(m.spans[0].first)),  plain_format);
+		cursor.insertText(QString::fromLocal8Bit(text.mid(m.spans[0].first,  m.spans[0].second - m.spans[0].first)),  match_format);
+		cursor.insertText(QString::fromLocal8Bit(text.mid(m.spans[0].second)),  plain_format);
+		for (size_t g = 1;  g < m.spans.size();  ++g){
+			if (m.spans[g].first == -1)
+				continue;
+			cursor.insertText("\n\t\t",  plain_format);
+			cursor.insertText((g < this->group_names.size()) ? this->group_names[g] : QString::number(g),  group_name_format);
+			cursor.insertText(":\t",  plain_format);
+			cursor.insertText(QString::fromLocal8Bit(text.mid(m.spans[g].first,  m.spans[g].second - m.spans[g].first)),  match_format);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef EGIX_PREVIEW_PANE_HPP
+#define EGIX_PREVIEW_PANE_HPP
+
+#include <QByteArray>
+#include <QString>
+#include <QWidget>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+class Corpus;
+class QLabel;
+class QTextEdit;
+class QTimer;
+struct PreviewRun;
+
+
+class PreviewPane : public QWidget {
+	/*
+	 * Shows the first matches of the last live-compiled regex on the loaded corpus.
+	 * Compiling and matching run on worker threads; starting a new run cancels the previous one without waiting for it, and its results, if they arrive, are discarded.
+	 * Results are rendered a few at a time, within a frame budget, so that typing is never blocked.
+	 */
+  public:
+	explicit PreviewPane(QWidget* parent = nullptr);
+	~PreviewPane();
+	void set_corpus(const Corpus* _corpus); // Must be called before the previous corpus is deleted
+	void run(const QByteArray& regex,  const std::vector<QString>& _group_names); // group_names[g] is the reason of capture group g
+	void show_status(const QString& msg); // Cancels any run in progress
+  private:
+	void cancel();
+	void reap(const bool wait);
+	void search(const std::shared_ptr<PreviewRun> run_state);
+	void search_slice(PreviewRun& run_state,  const size_t slice_indx);
+	void deliver(const uint64_t _generation);
+	void render_some();
+	
+	QLabel* status;
+	QTextEdit* view;
+	QTimer* render_timer;
+	const Corpus* corpus;
+	std::atomic<uint64_t> generation;
+	std::thread coordinator;
+	std::shared_ptr<PreviewRun> current;
+	std::vector<std::pair<std::thread, std::shared_ptr<PreviewRun>>> retired; // Coordinators of cancelled runs, which may still be finishing a record
+	std::vector<QString> group_names;
+	size_t n_rendered;
+};
+
+
+#endif
@@ -0,0 +1,299 @@
+#include "project.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+#include <QUrl>
+
+#include <algorithm>
+
+
+static const QString index_file_name = ".egix-index";
+static const QString index_header = "#egix-index"; // Followed by the build key
+static const QString output_dir_name = ".egix-build";
+static const QStringList source_name_filters = {"*.re", "*.regex", "*.egix"};
+
+
+static
+QString join_encoded(const QStringList& l){
+	// Names may contain any characters, including the seperators
+	QStringList encoded;
+	for (const QString& s : l)
+		encoded << QString::fromLatin1(QUrl::toPercentEncoding(s));
+	return encoded.join(",");
+}
+
+static
+QStringList split_encoded(const QString& s){
+	QStringList l;
+	if (s.isEmpty())
+		return l;
+	for (const QString& e : s.split(","))
+		l << QUrl::fromPercentEncoding(e.toLatin1());
+	return l;
+}
+
+
+void Project::scan(ProjectFile& file,  const QString& q){
+	// A lexical scan of the source, mirroring the preprocessor's treatment of escapes and comments
+	file.declares.clear();
+	file.uses.clear();
+	file.word_lists.clear();
+	QStringList uses;
+	for (int i = 0;  i < q.size();  ++i){
+		const QChar c = q.at(i);
+		if (c == QChar('\\')){
+			++i;
+			continue;
+		}
+		if (c == QChar('#')  &&  (i == 0  ||  q.at(i-1) == QChar(' ')  ||  q.at(i-1) == QChar('\t')  ||  q.at(i-1) == QChar('\n'))){
+			while(i < q.size()  &&  q.at(i) != QChar('\n'))
+				++i;
+			continue;
+		}
+		if (c == QChar('{')  &&  q.midRef(i + 1,  3) == QLatin1String("?P<")){
+			const int name_start = i + 4;
+			const int name_end = q.indexOf(QChar('>'),  name_start);
+			if (name_end == -1)
+				break;
+			file.declares << q.mid(name_start,  name_end - name_start);
+			i = name_end;
+			continue;
+		}
+		if (c == QChar('$')  &&  i + 1 < q.size()  &&  q.at(i+1) == QChar('{')){
+			const int name_start = i + 2;
+			const int name_end = q.indexOf(QChar('}'),  name_start);
+			if (name_end == -1)
+				break;
+			const QString name = q.mid(name_start,  name_end - name_start);
+			if (name.startsWith(QChar('@'))){
+				if (!file.word_lists.contains(name.mid(1)))
+					file.word_lists << name.mid(1);
+			} else if (!uses.contains(name)){
+				uses << name;
+			}
+			i = name_end;
+			continue;
+		}
+	}
+	for (const QString& name : uses)
+		if (!file.declares.contains(name))
+			file.uses << name;
+}
+
+
+QStringList Project::word_list_stamps(const ProjectFile& file) const {
+	// Word lists are resolved relative to the including file, as the preprocessor resolves them
+	const QDir file_dir = QFileInfo(QDir(this->dir).filePath(file.path)).absoluteDir();
+	QStringList stamps;
+	for (const QString& word_list : file.word_lists){
+		const QFileInfo info(file_dir.filePath(word_list));
+		stamps << ((info.exists()) ? QString("%1:%2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()) : QString("missing"));
+	}
+	return stamps;
+}
+
+
+bool Project::open(const QString& _dir,  const QString& _build_key){
+	this->dir = _dir;
+	this->build_key = _build_key;
+	this->files.clear();
+	this->warnings.clear();
+	this->removed.clear();
+	this->var2file.clear();
+	
+	// path -> indexed entry
+	QHash<QString, ProjectFile> indexed;
+	{
+		QFile f(QDir(this->dir).filePath(index_file_name));
+		if (f.open(QIODevice::ReadOnly)){
+			QTextStream in(&f);
+			in.setCodec("UTF-8");
+			// Outputs built with another version of egix, or with other settings, are out of date - but the scans of the sources can still be reused
+			const bool same_build_key = (in.readLine() == index_header + "\t" + this->build_key);
+			while(!in.atEnd()){
+				const QStringList fields = in.readLine().split("\t");
+				if (fields.size() != 9)
+					continue;
+				ProjectFile file;
+				file.path = QUrl::fromPercentEncoding(fields[0].toLatin1());
+				file.size = fields[1].toLongLong();
+				file.mtime = fields[2].toLongLong();
+				file.built = (same_build_key  &&  fields[3] == "1");
+				file.declares = split_encoded(fields[4]);
+				file.uses = split_encoded(fields[5]);
+				file.providers = split_encoded(fields[6]);
+				file.word_lists = split_encoded(fields[7]);
+				file.word_list_stamps = split_encoded(fields[8]);
+				indexed.insert(file.path, file);
+			}
+			f.close();
+		}
+	}
+	
+	const QDir root(this->dir);
+	QDirIterator it(this->dir,  source_name_filters,  QDir::Files,  QDirIterator::Subdirectories);
+	while(it.hasNext()){
+		const QString abs_path = it.next();
+		const QString path = root.relativeFilePath(abs_path);
+		if (path.startsWith(output_dir_name + "/"))
+			continue;
+		const QFileInfo info = it.fileInfo();
+		const auto entry = indexed.constFind(path);
+		if (entry != indexed.constEnd()  &&  entry->size == info.size()  &&  entry->mtime == info.lastModified().toMSecsSinceEpoch()){
+			this->files.push_back(entry.value());
+			ProjectFile& file = this->files.back();
+			const QStringList stamps = this->word_list_stamps(file);
+			if (stamps != file.word_list_stamps){
+				file.word_list_stamps = stamps;
+				file.built = false;
+			}
+			continue;
+		}
+		ProjectFile file;
+		file.path = path;
+		file.size = info.size();
+		file.mtime = info.lastModified().toMSecsSinceEpoch();
+		file.built = false;
+		QFile f(abs_path);
+		if (!f.open(QIODevice::ReadOnly)){
+			this->error = path + ": " + f.errorString();
+			return false;
+		}
+		this->scan(file,  QString::fromUtf8(f.readAll()));
+		f.close();
+		file.word_list_stamps = this->word_list_stamps(file);
+		if (entry != indexed.constEnd())
+			file.providers = entry->providers; // So that a change of providers can be detected
+		this->files.push_back(file);
+	}
+	std::sort(this->files.begin(),  this->files.end(),  [](const ProjectFile& a,  const ProjectFile& b){ return a.path < b.path; });
+	{
+		QSet<QString> paths;
+		for (const ProjectFile& file : this->files)
+			paths.insert(file.path);
+		for (auto entry = indexed.constBegin();  entry != indexed.constEnd();  ++entry)
+			if (!paths.contains(entry.key()))
+				this->removed << entry.key();
+	}
+	
+	for (size_t f = 0;  f < this->files.size();  ++f){
+		for (const QString& name : this->files[f].declares){
+			const auto existing = this->var2file.constFind(name);
+			if (existing != this->var2file.constEnd()){
+				if (existing.value() != f)
+					this->warnings << QString("${%1} is declared by both %2 and %3; the former is used").arg(name).arg(this->files[existing.value()].path).arg(this->files[f].path);
+				continue;
+			}
+			this->var2file.insert(name, f);
+		}
+	}
+	
+	// A file must also be rebuilt if the files providing its variables have changed, e.g. if a variable was moved between files
+	for (size_t f = 0;  f < this->files.size();  ++f){
+		QStringList provider_paths;
+		for (const size_t p : this->providers(f))
+			provider_paths << this->files[p].path;
+		if (provider_paths != this->files[f].providers){
+			this->files[f].providers = provider_paths;
+			this->files[f].built = false;
+		}
+	}
+	
+	return true;
+}
+
+
+bool Project::save_index() const {
+	// Written to a temporary file that replaces the index only once complete, so that an interrupted save cannot leave a truncated index - which would mark files built that were not, or lose the record of those that were
+	QSaveFile f(QDir(this->dir).filePath(index_file_name));
+	if (!f.open(QIODevice::WriteOnly))
+		return false;
+	QTextStream out(&f);
+	out.setCodec("UTF-8");
+	out << index_header << "\t" << this->build_key << "\n";
+	for (const ProjectFile& file : this->files)
+		out << QUrl::toPercentEncoding(file.path) << "\t" << file.size << "\t" << file.mtime << "\t" << ((file.built) ? "1" : "0") << "\t" << join_encoded(file.declares) << "\t" << join_encoded(file.uses) << "\t" << join_encoded(file.providers) << "\t" << join_encoded(file.word_lists) << "\t" << join_encoded(file.word_list_stamps) << "\n";
+	out.flush();
+	return f.commit();
+}
+
+
+QString Project::error_string() const {
+	return this->error;
+}
+
+
+QString Project::output_path(const QString& path) const {
+	return QDir(this->dir).filePath(output_dir_name + "/" + path);
+}
+
+
+std::vector<size_t> Project::providers(const size_t f) const {
+	std::vector<size_t> v;
+	for (const QString& name : this->files[f].uses){
+		const auto it = this->var2file.constFind(name);
+		if (it != this->var2file.constEnd()  &&  std::find(v.begin(), v.end(), it.value()) == v.end())
+			v.push_back(it.value());
+	}
+	return v;
+}
+
+
+bool Project::build_order(std::vector<size_t>& to_build,  std::vector<size_t>& order){
+	const size_t n = this->files.size();
+	std::vector<std::vector<size_t>> provider_lists(n);
+	std::vector<std::vector<size_t>> dependents(n);
+	for (size_t f = 0;  f < n;  ++f){
+		provider_lists[f] = this->providers(f);
+		for (const size_t p : provider_lists[f])
+			dependents[p].push_back(f);
+	}
+	
+	// Dependents of a rebuilt file substitute its variables, so must be rebuilt too
+	std::vector<bool> building(n, false);
+	for (const size_t f : to_build)
+		building[f] = true;
+	for (size_t k = 0;  k < to_build.size();  ++k)
+		for (const size_t d : dependents[to_build[k]])
+			if (!building[d]){
+				building[d] = true;
+				to_build.push_back(d);
+			}
+	
+	// Depth-first topological sort of the files to build and their providers, whose variables must be known first
+	enum { unvisited, visiting, visited };
+	std::vector<int> state(n, unvisited);
+	std::vector<std::pair<size_t, size_t>> stack; // File, index of next provider to visit
+	for (const size_t root : to_build){
+		if (state[root] != unvisited)
+			continue;
+		stack.emplace_back(root, 0);
+		state[root] = visiting;
+		while(!stack.empty()){
+			const size_t f = stack.back().first;
+			const size_t k = stack.back().second++;
+			if (k == provider_lists[f].size()){
+				state[f] = visited;
+				order.push_back(f);
+				stack.pop_back();
+				continue;
+			}
+			const size_t p = provider_lists[f][k];
+			if (state[p] == visiting){
+				this->error = QString("Variables of %1 and %2 depend on each other").arg(this->files[f].path).arg(this->files[p].path);
+				return false;
+			}
+			if (state[p] == unvisited){
+				state[p] = visiting;
+				stack.emplace_back(p, 0);
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,59 @@
+#ifndef EGIX_PROJECT_HPP
+#define EGIX_PROJECT_HPP
+
+#include "group_table.hpp"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+
+struct VarValue {
+	QString name;
+	QString value; // Preprocessed
+	GroupTable groups; // Of the value, with offsets relative to its start
+};
+
+
+struct ProjectFile {
+	QString path; // Relative to the project directory
+	qint64 size;
+	qint64 mtime;
+	bool built; // Whether the output is up to date with the source
+	QStringList declares; // Variables declared with {?P<name>...}
+	QStringList uses; // Variables used with ${name} but not declared in the file itself
+	QStringList providers; // Paths of the files that declare the variables it uses, as of the last build
+	QStringList word_lists; // Paths of the word lists it includes with ${@path}, relative to its directory
+	QStringList word_list_stamps; // Size and modification time of each word list, as of the last scan
+};
+
+
+class Project {
+	/*
+	 * A directory of regex sources which may use each other's variables.
+	 * The variable declarations and uses of each file are indexed in .egix-index, so that only files whose size or modification time have changed need to be rescanned when the project is opened.
+	 * Every output is invalidated if the build key - e.g. the egix version and optimisation mode - differs from the one indexed.
+	 */
+  public:
+	bool open(const QString& _dir,  const QString& _build_key);
+	bool save_index() const;
+	QString error_string() const;
+	QString output_path(const QString& path) const;
+	std::vector<size_t> providers(const size_t f) const; // Files declaring the variables that f uses
+	bool build_order(std::vector<size_t>& to_build,  std::vector<size_t>& order); // Adds the (transitive) dependents of to_build to it, and sets order to those files and their (transitive) providers, with providers first. Returns false if there is a cycle.
+	
+	QString dir;
+	std::vector<ProjectFile> files;
+	QStringList warnings; // e.g. variables declared by several files
+	QStringList removed; // Paths of indexed files that no longer exist, whose outputs are stale
+  private:
+	void scan(ProjectFile& file,  const QString& content);
+	QStringList word_list_stamps(const ProjectFile& file) const;
+	QString build_key;
+	QHash<QString, size_t> var2file;
+	QString error;
+};
+
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Differential testing of two regexes that should accept the same language - e.g. a regex and its optimised form.
+ * Both regex_search (does the input contain a match) and regex_match (is the input in the language) must agree, and so must the spans of the groups of their matches - as the groups are what is reported.
+ */
+
+#include "regex_diff.hpp"
+
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+
+constexpr static const size_t max_disagreements_kept = 100;
+
+
+void mutate_strings(const std::vector<std::string>& strs,  std::vector<std::string>& mutants,  const unsigned seed,  const size_t n_mutants_per_str){
+	// Mutants of matching strings are the most likely strings to expose a difference, as they lie just outside (or inside) the language
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> printable(0x20, 0x7e);
+	mutants.emplace_back(); // The empty string
+	for (const std::string& str : strs){
+		for (size_t n = 0;  n < n_mutants_per_str;  ++n){
+			std::string s = str;
+			const size_t pos = s.empty() ? 0 : std::uniform_int_distribution<size_t>(0, s.size() - 1)(rng);
+			switch(rng() % 6){
+				case 0:
+					if (!s.empty())
+						s.erase(pos, 1);
+					break;
+				case 1:
+					s.insert(s.begin() + pos,  (char)printable(rng));
+					break;
+				case 2:
+					if (!s.empty())
+						s[pos] = (char)printable(rng);
+					break;
+				case 3:
+					if (pos + 1 < s.size())
+						std::swap(s[pos], s[pos+1]);
+					break;
+				case 4:
+					s.resize(pos);
+					break;
+				case 5:
+					if (!s.empty())
+						s.insert(s.begin() + pos,  s[pos]);
+					break;
+			}
+			mutants.push_back(s);
+		}
+	}
+}
+
+
+constexpr static const char gave_up = 2; // In place of whether it matched, if boost threw instead of answering
+
+
+static
+double time_regex(const Regex& r,  const std::vector<CorpusRecord>& inputs,  std::vector<char>& found,  std::vector<char>& matched){
+	// Boost throws std::runtime_error if it gives up on an input - e.g. if it runs out of stack space, or exceeds its complexity limit - which must not end the whole run
+	found.resize(inputs.size());
+	matched.resize(inputs.size());
+	const auto t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0;  i < inputs.size();  ++i){
+		try {
+			found[i] = boost::regex_search(inputs[i].begin,  inputs[i].end,  r);
+		} catch (std::runtime_error&){
+			found[i] = gave_up;
+		}
+	}
+	const auto t1 = std::chrono::steady_clock::now();
+	for (size_t i = 0;  i < inputs.size();  ++i){
+		try {
+			matched[i] = boost::regex_match(inputs[i].begin,  inputs[i].end,  r);
+		} catch (std::runtime_error&){
+			matched[i] = gave_up;
+		}
+	}
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+
+static
+bool same_spans(const boost::match_results<const char*>& a,  const boost::match_results<const char*>& b,  const size_t n_subs){
+	for (size_t g = 0;  g < n_subs;  ++g){
+		if (a[g].matched != b[g].matched)
+			return false;
+		if (a[g].matched  &&  (a[g].first != b[g].first  ||  a[g].second != b[g].second))
+			return false;
+	}
+	return true;
+}
+
+
+void diff_regexes(const Regex& a,  const Regex& b,  const std::vector<CorpusRecord>& inputs,  RegexDiffResult& result){
+	std::vector<char> found_a, matched_a, found_b, matched_b;
+	result.n_inputs += inputs.size();
+	result.ms_a += time_regex(a, inputs, found_a, matched_a);
+	result.ms_b += time_regex(b, inputs, found_b, matched_b);
+	
+	// Groups are matched by index, which is only meaningful if both regexes have the same number of them
+	const bool compare_groups = (a.mark_count() == b.mark_count());
+	if (!compare_groups)
+		result.compared_groups = false;
+	const size_t n_subs = (compare_groups) ? a.mark_count() + 1 : 1;
+	boost::match_results<const char*> m_a, m_b;
+	for (size_t i = 0;  i < inputs.size();  ++i){
+		const bool a_gave_up = (found_a[i] == gave_up  ||  matched_a[i] == gave_up);
+		const bool b_gave_up = (found_b[i] == gave_up  ||  matched_b[i] == gave_up);
+		if (a_gave_up  ||  b_gave_up){
+			++result.n_failures;
+			if (a_gave_up  &&  b_gave_up)
+				// Neither answered, so there is nothing to compare
+				continue;
+			// Otherwise one regex answered where the other gave up, which is itself a difference between them
+		} else if (found_a[i] == found_b[i]  &&  matched_a[i] == matched_b[i]){
+			bool spans_differ = false;
+			try {
+				if (found_a[i]){
+					boost::regex_search(inputs[i].begin,  inputs[i].end,  m_a,  a);
+					boost::regex_search(inputs[i].begin,  inputs[i].end,  m_b,  b);
+					spans_differ = !same_spans(m_a, m_b, n_subs);
+				}
+				if (matched_a[i]  &&  !spans_differ){
+					boost::regex_match(inputs[i].begin,  inputs[i].end,  m_a,  a);
+					boost::regex_match(inputs[i].begin,  inputs[i].end,  m_b,  b);
+					spans_differ = !same_spans(m_a, m_b, n_subs);
+				}
+			} catch (std::runtime_error&){
+				// Both answered once, so this is unlikely, but boost's limits are per call
+				++result.n_failures;
+				continue;
+			}
+			if (!spans_differ)
+				continue;
+			++result.n_span_disagreements;
+		}
+		if (result.n_disagreements++ < max_disagreements_kept)
+			result.disagreements.emplace_back(inputs[i].begin,  inputs[i].end);
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef EGIX_REGEX_DIFF_HPP
+#define EGIX_REGEX_DIFF_HPP
+
+#include "corpus_record.hpp"
+
+#include <boost/regex.hpp>
+
+#include <string>
+#include <vector>
+
+
+typedef boost::basic_regex<char, boost::cpp_regex_traits<char>> Regex;
+
+
+struct RegexDiffResult {
+	size_t n_inputs = 0;
+	size_t n_disagreements = 0; // Inputs on which the regexes disagree, whether on if they match, or on the spans of their groups
+	size_t n_span_disagreements = 0; // Those on which they agree on if they match, but not on the spans
+	size_t n_failures = 0; // Inputs on which boost gave up (threw std::runtime_error) with either regex. Those on which only one regex gave up are also disagreements.
+	bool compared_groups = true; // False if the regexes have different numbers of groups, so that only the spans of their whole matches could be compared
+	std::vector<std::string> disagreements; // Only the first max_disagreements_kept are kept
+	double ms_a = 0; // Total time spent searching all inputs with regex a
+	double ms_b = 0;
+};
+
+
+void mutate_strings(const std::vector<std::string>& strs,  std::vector<std::string>& mutants,  const unsigned seed,  const size_t n_mutants_per_str);
+
+void diff_regexes(const Regex& a,  const Regex& b,  const std::vector<CorpusRecord>& inputs,  RegexDiffResult& result);
+
+
+#endif
@@ -0,0 +1,300 @@
+#include "regex_metrics.hpp"
+#include "corpus.hpp"
+#include "egix/dfa.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <new>
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+
+static
+bool is_counted_repeat(const char* s){
+	// s follows a '{'. Whether it is {n}, {n,} or {n,m}, rather than a literal brace
+	if (!isdigit((unsigned char)*s))
+		return false;
+	while(isdigit((unsigned char)*s))
+		++s;
+	if (*s == ',')
+		++s;
+	while(isdigit((unsigned char)*s))
+		++s;
+	return (*s == '}');
+}
+
+
+static
+const char* skip_past(const char* s,  const char terminator){
+	while(*s != 0  &&  *s != terminator)
+		++s;
+	return (*s == 0) ? s : s + 1;
+}
+
+
+static
+void scan_pattern(const char* s,  RegexMetrics& m){
+	std::vector<bool> group_has_repeat = {false}; // Of each open group, whether it contains a repeat. The first entry is the whole regex.
+	bool after_quantifier = false; // If so, a ? or + makes that quantifier lazy or possessive, rather than being a repeat itself
+	bool after_repeating_group = false; // Whether the preceding atom is a group containing a repeat
+	while(*s != 0){
+		const char c = *s++;
+		bool is_quantifier = false;
+		bool closed_repeating_group = false;
+		switch(c){
+			case '\\': {
+				const char e = *s;
+				if (e == 0)
+					break;
+				++s;
+				if (e == 'Q'){
+					// Quoted literal text
+					const char* const end = strstr(s, "\\E");
+					const char* const quote_end = (end == nullptr) ? s + strlen(s) : end;
+					m.n_atoms += quote_end - s;
+					s = (end == nullptr) ? quote_end : end + 2;
+				} else if ((e >= '1'  &&  e <= '9')  ||  ((e == 'g'  ||  e == 'k')  &&  *s != 0  &&  strchr("{<'-0123456789", *s) != nullptr)){
+					++m.n_backrefs;
+					++m.n_atoms;
+					if (e >= '1'  &&  e <= '9'){
+						while(isdigit((unsigned char)*s))
+							++s;
+					} else if (*s == '{'  ||  *s == '<'  ||  *s == '\''){
+						s = skip_past(s + 1,  (*s == '{') ? '}' : (*s == '<') ? '>' : '\'');
+					} else {
+						if (*s == '-')
+							++s;
+						while(isdigit((unsigned char)*s))
+							++s;
+					}
+				} else {
+					++m.n_atoms;
+					if (*s == '{'  &&  strchr("xpPNo", e) != nullptr)
+						// e.g. \x{263a}, \p{alpha}
+						s = skip_past(s, '}');
+				}
+				break;
+			}
+			case '[':
+				// A set matches a single character, so is a single atom
+				if (*s == '^')
+					++s;
+				if (*s == ']')
+					++s;
+				while(*s != 0  &&  *s != ']'){
+					if (*s == '\\'  &&  s[1] != 0){
+						s += 2;
+					} else if (*s == '['  &&  s[1] == ':'){
+						const char* const end = strstr(s, ":]");
+						s = (end == nullptr) ? s + 1 : end + 2;
+					} else {
+						++s;
+					}
+				}
+				if (*s == ']')
+					++s;
+				++m.n_atoms;
+				break;
+			case '(':
+				if (*s != '?'){
+					group_has_repeat.push_back(false);
+					break;
+				}
+				++s;
+				if (*s == '#'){
+					// Comment
+					s = skip_past(s, ')');
+				} else if ((*s == 'P'  &&  (s[1] == '='  ||  s[1] == '>'))  ||  *s == '&'  ||  *s == 'R'  ||  *s == '+'  ||  *s == '-'  ||  isdigit((unsigned char)*s)){
+					// Named backreference, or a recursion
+					if (*s == 'P'  &&  s[1] == '=')
+						++m.n_backrefs;
+					++m.n_atoms;
+					s = skip_past(s, ')');
+				} else if ((*s == 'P'  &&  s[1] == '<')  ||  (*s == '<'  &&  s[1] != '='  &&  s[1] != '!')  ||  *s == '\''){
+					// Named group
+					s = skip_past(s + ((*s == 'P') ? 2 : 1),  (*s == '\'') ? '\'' : '>');
+					group_has_repeat.push_back(false);
+				} else if (*s == '<'){
+					// Lookbehind
+					s += 2;
+					group_has_repeat.push_back(false);
+				} else if (*s == ':'  ||  *s == '='  ||  *s == '!'  ||  *s == '>'  ||  *s == '|'){
+					++s;
+					group_has_repeat.push_back(false);
+				} else {
+					// Flags, either for the rest of the enclosing group, as in (?i), or for a group, as in (?i:...)
+					while(isalpha((unsigned char)*s)  ||  *s == '-')
+						++s;
+					if (*s == ':'){
+						++s;
+						group_has_repeat.push_back(false);
+					} else if (*s == ')'){
+						++s;
+					}
+				}
+				break;
+			case ')':
+				if (group_has_repeat.size() > 1){
+					closed_repeating_group = group_has_repeat.back();
+					group_has_repeat.pop_back();
+					if (closed_repeating_group)
+						group_has_repeat.back() = true;
+				}
+				break;
+			case '|':
+				++m.n_alternatives;
+				break;
+			case '*':
+			case '+':
+			case '?':
+				is_quantifier = true;
+				break;
+			case '{':
+				if (is_counted_repeat(s)){
+					s = skip_past(s, '}');
+					is_quantifier = true;
+				} else {
+					++m.n_atoms;
+				}
+				break;
+			case '^':
+			case '$':
+				break;
+			default:
+				++m.n_atoms;
+				break;
+		}
+		if (is_quantifier  &&  after_quantifier  &&  (c == '?'  ||  c == '+')){
+			// Lazy or possessive modifier
+			is_quantifier = false;
+		} else if (is_quantifier){
+			++m.n_repeats;
+			if (after_repeating_group)
+				++m.n_nested_repeats;
+			group_has_repeat.back() = true;
+		}
+		after_quantifier = is_quantifier;
+		after_repeating_group = closed_repeating_group;
+	}
+}
+
+
+#ifdef __GLIBC__
+/*
+ * Boost does not expose the size of its compiled form, and allocates it internally with operator new, so count what operator new hands out while the regex is compiled.
+ * Only the allocations of the thread that set counting_heap are counted, and only while it is set; every other allocation just pays for reading a thread_local.
+ * mallinfo2 is no substitute: it covers every thread, and a freed chunk that is cached for reuse still counts as in use, so recompiling a regex shows no growth at all.
+ * Both are volatile because GCC assumes that operator new touches no other memory, and would otherwise drop the store of true and read back the initial count.
+ */
+static thread_local volatile bool counting_heap = false;
+static thread_local volatile long long heap_counted = 0;
+
+void* operator new(size_t n){
+	void* const p = malloc((n == 0) ? 1 : n);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	if (counting_heap)
+		heap_counted += malloc_usable_size(p);
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	if (p != nullptr  &&  counting_heap)
+		heap_counted -= malloc_usable_size(p);
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wmismatched-new-delete" // When inlined into a delete expression, GCC does not see that this operator new allocated with malloc
+	free(p);
+# pragma GCC diagnostic pop
+}
+
+void operator delete(void* p,  size_t) noexcept {
+	operator delete(p);
+}
+#endif
+
+
+static
+size_t compiled_size(const char* regex,  const boost::regex_constants::syntax_option_type flags){
+	// Compiles another copy of the regex, as the first has already been allocated
+#ifdef __GLIBC__
+	heap_counted = 0;
+	counting_heap = true;
+	try {
+		const boost::basic_regex<char, boost::cpp_regex_traits<char>> r(regex,  flags);
+		counting_heap = false; // Before r is destroyed
+	} catch (...){
+		counting_heap = false;
+		throw;
+	}
+	const long long n_bytes = heap_counted;
+	return (n_bytes > 0) ? (size_t)n_bytes : 0;
+#else
+	return 0;
+#endif
+}
+
+
+void measure_regex(const boost::basic_regex<char, boost::cpp_regex_traits<char>>& r,  const char* regex,  RegexMetrics& m){
+	m.pattern_len = strlen(regex);
+	m.n_groups = r.mark_count();
+	m.n_atoms = 0;
+	m.n_alternatives = 0;
+	m.n_repeats = 0;
+	m.n_nested_repeats = 0;
+	m.n_backrefs = 0;
+	scan_pattern(regex, m);
+	
+	m.compiled_bytes = compiled_size(regex,  r.flags());
+	
+	// Each match attempt may step through every atom, and each choice point may need to be backtracked over - repeatedly so, for nested repeats
+	m.est_cost = m.n_atoms + 2.0 * m.n_alternatives + 4.0 * m.n_repeats + 16.0 * m.n_backrefs + 64.0 * m.n_nested_repeats;
+	
+	std::string why_not;
+	const Dfa* const dfa = Dfa::compile(regex, why_not);
+	m.dfa_states = (dfa == nullptr) ? 0 : dfa->n_states();
+	m.dfa_bytes  = (dfa == nullptr) ? 0 : dfa->memory();
+	delete dfa;
+	
+	m.us_per_kib = -1;
+}
+
+
+void time_regex(const boost::basic_regex<char, boost::cpp_regex_traits<char>>& r,  const std::vector<CorpusRecord>& records,  RegexMetrics& m){
+	size_t n_bytes = 0;
+	const auto t0 = std::chrono::steady_clock::now();
+	for (const CorpusRecord& record : records){
+		boost::regex_search(record.begin,  record.end,  r);
+		n_bytes += record.end - record.begin;
+	}
+	const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+	m.us_per_kib = (n_bytes == 0) ? 0 : us * 1024 / n_bytes;
+}
+
+
+std::string metrics_to_json(const RegexMetrics& m){
+	std::string s = "{";
+	auto add = [&s](const char* key,  const std::string& value){
+		if (s.size() != 1)
+			s += ",";
+		s += "\"";
+		s += key;
+		s += "\":";
+		s += value;
+	};
+	add("pattern_len",          std::to_string(m.pattern_len));
+	add("groups",               std::to_string(m.n_groups));
+	add("atoms",                std::to_string(m.n_atoms));
+	add("alternatives",         std::to_string(m.n_alternatives));
+	add("repeats",              std::to_string(m.n_repeats));
+	add("nested_repeats",       std::to_string(m.n_nested_repeats));
+	add("backrefs",             std::to_string(m.n_backrefs));
+	add("compiled_bytes",       (m.compiled_bytes == 0) ? std::string("null") : std::to_string(m.compiled_bytes));
+	add("est_cost_heuristic",   std::to_string(m.est_cost));
+	add("dfa_states",           std::to_string(m.dfa_states));
+	add("dfa_bytes",            std::to_string(m.dfa_bytes));
+	add("us_per_kib",           (m.us_per_kib < 0) ? std::string("null") : std::to_string(m.us_per_kib));
+	s += "}";
+	return s;
+}
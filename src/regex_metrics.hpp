@@ -0,0 +1,35 @@
+#ifndef EGIX_REGEX_METRICS_HPP
+#define EGIX_REGEX_METRICS_HPP
+
+#include <boost/regex.hpp>
+
+#include <string>
+#include <vector>
+
+
+struct CorpusRecord;
+
+
+struct RegexMetrics {
+	// Only boost's public interface is used, as its compiled form differs between versions; the structural counts are from the pattern itself
+	size_t pattern_len;
+	size_t n_groups;
+	size_t n_atoms; // Literals, sets, classes and other single-character matchers
+	size_t n_alternatives; // Unescaped |, i.e. choice points for the backtracking matcher
+	size_t n_repeats;
+	size_t n_nested_repeats; // Repeats of groups that themselves contain a repeat, e.g. (a+)* - the usual cause of catastrophic backtracking
+	size_t n_backrefs;
+	size_t compiled_bytes; // Heap allocated by compiling the regex, measured; 0 if the heap cannot be measured on this platform
+	double est_cost; // Heuristic relative cost, from the counts above; only comparable between regexes, and no substitute for us_per_kib
+	size_t dfa_states; // 0 if the regex cannot be compiled to a DFA
+	size_t dfa_bytes;
+	double us_per_kib; // Measured on a corpus, or -1 if none was given
+};
+
+
+void measure_regex(const boost::basic_regex<char, boost::cpp_regex_traits<char>>& r,  const char* regex,  RegexMetrics& m);
+void time_regex(const boost::basic_regex<char, boost::cpp_regex_traits<char>>& r,  const std::vector<CorpusRecord>& records,  RegexMetrics& m);
+std::string metrics_to_json(const RegexMetrics& m);
+
+
+#endif
@@ -1,9 +1,13 @@
 #include "regopt.hpp"
+#include "trace.hpp"
 #include <QProcess>
 #include <QMessageBox>
 
 
 void optimise_regex(QString& data,  QString& result){
+	EGIX_TRACE_SCOPE("regopt.pl");
+	trace::count("regopt.pl calls");
+	trace::count("regopt.pl input chars",  data.size());
 	QProcess regtrie;
 	QStringList args;
 	for (int i = data.length();  i != 0;  ){
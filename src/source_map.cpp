@@ -0,0 +1,116 @@
+#include "source_map.hpp"
+
+#include <algorithm>
+
+
+void SourceMap::clear(){
+	this->runs.clear();
+}
+
+int SourceMap::size() const {
+	return (this->runs.empty()) ? 0 : this->runs.back().dst + this->runs.back().len;
+}
+
+size_t SourceMap::n_runs() const {
+	return this->runs.size();
+}
+
+void SourceMap::truncate(const int dst_end){
+	while(!this->runs.empty()  &&  this->runs.back().dst >= dst_end)
+		this->runs.pop_back();
+	if (this->runs.empty())
+		return;
+	Run& last = this->runs.back();
+	if (last.dst + last.len <= dst_end)
+		return;
+	last.len = dst_end - last.dst;
+	if (last.verbatim)
+		last.src.end = last.src.start + last.len;
+}
+
+void SourceMap::push(const Run& run){
+	if (run.len == 0)
+		return;
+	this->truncate(run.dst); // The preprocessor overwrites its output when it backtracks, e.g. over whitespace preceding a comment
+	if (!this->runs.empty()){
+		Run& last = this->runs.back();
+		if (last.dst + last.len == run.dst  &&  last.verbatim  &&  run.verbatim  &&  last.src.end == run.src.start){
+			last.len += run.len;
+			last.src.end = run.src.end;
+			return;
+		}
+		if (last.dst + last.len == run.dst  &&  !last.verbatim  &&  !run.verbatim  &&  last.src.start == run.src.start  &&  last.src.end == run.src.end){
+			last.len += run.len;
+			return;
+		}
+	}
+	this->runs.push_back(run);
+}
+
+void SourceMap::add(const int dst,  const int src){
+	this->push({dst,  1,  {src,  src + 1},  true});
+}
+
+void SourceMap::add_span(const int dst,  const int len,  const SourceSpan src){
+	this->push({dst,  len,  src,  false});
+}
+
+void SourceMap::copy(const int dst,  const int from,  const int len){
+	// Collect first, as pushing may reallocate (or truncate) the runs being copied
+	std::vector<Run> copied;
+	for (const Run& run : this->runs){
+		const int overlap_start = std::max(run.dst,  from);
+		const int overlap_end   = std::min(run.dst + run.len,  from + len);
+		if (overlap_start >= overlap_end)
+			continue;
+		Run r = run;
+		r.dst = dst + (overlap_start - from);
+		r.len = overlap_end - overlap_start;
+		if (run.verbatim){
+			r.src.start = run.src.start + (overlap_start - run.dst);
+			r.src.end   = r.src.start + r.len;
+		}
+		copied.push_back(r);
+	}
+	for (const Run& r : copied)
+		this->push(r);
+}
+
+SourceSpan SourceMap::lookup(const int dst) const {
+	auto it = std::upper_bound(
+		this->runs.begin(),
+		this->runs.end(),
+		dst,
+		[](const int d,  const Run& run){
+			return d < run.dst;
+		}
+	);
+	if (it == this->runs.begin())
+		return {0, 0};
+	--it;
+	if (dst >= it->dst + it->len)
+		// Past the end of the output, e.g. boost reporting an error at the very end of the regex
+		return {it->src.end,  it->src.end};
+	if (it->verbatim)
+		return {it->src.start + (dst - it->dst),  it->src.start + (dst - it->dst) + 1};
+	return it->src;
+}
+
+
+LineIndex::LineIndex(const QString& s){
+	this->line_starts.push_back(0);
+	for (auto i = 0;  i < s.size();  ++i)
+		if (s.at(i) == QChar('\n'))
+			this->line_starts.push_back(i + 1);
+}
+
+SourcePosition LineIndex::position(const int offset) const {
+	const auto it = std::upper_bound(this->line_starts.begin(),  this->line_starts.end(),  std::max(offset, 0));
+	const int line = it - this->line_starts.begin(); // line_starts[0] == 0 <= offset, so line >= 1
+	return {line,  std::max(offset, 0) - this->line_starts[line - 1] + 1};
+}
+
+QString LineIndex::describe(const int offset) const {
+	const SourcePosition pos = this->position(offset);
+	return QString("line %1, column %2").arg(pos.line).arg(pos.column);
+}
@@ -0,0 +1,57 @@
+#ifndef EGIX_SOURCE_MAP_HPP
+#define EGIX_SOURCE_MAP_HPP
+
+#include <QString>
+#include <vector>
+
+
+struct SourceSpan {
+	int start;
+	int end; // Exclusive
+};
+
+
+class SourceMap {
+	/*
+	 * Maps offsets in the preprocessor's output back to spans of its source.
+	 * Stored as runs - most runs are verbatim copies of the source, so even large regexes need only a handful of runs - with O(log n) lookup.
+	 */
+  public:
+	void clear();
+	void truncate(const int dst_end);
+	void add(const int dst,  const int src); // Map a single character, verbatim
+	void add_span(const int dst,  const int len,  const SourceSpan src); // Map every character in [dst, dst+len) to the whole of src, e.g. for optimised groups
+	void copy(const int dst,  const int from,  const int len); // Map [dst, dst+len) like [from, from+len), e.g. for variable substitutions
+	SourceSpan lookup(const int dst) const;
+	int size() const;
+	size_t n_runs() const;
+  private:
+	struct Run {
+		int dst;
+		int len;
+		SourceSpan src;
+		bool verbatim; // If true, dst+k maps to src.start+k; otherwise every character maps to the whole of src
+	};
+	void push(const Run& run);
+	std::vector<Run> runs;
+};
+
+
+struct SourcePosition {
+	int line;   // Starting from 1
+	int column; // Starting from 1
+};
+
+
+class LineIndex {
+	// Line and column lookup in O(log n), rather than rescanning the source for every position
+  public:
+	explicit LineIndex(const QString& s);
+	SourcePosition position(const int offset) const;
+	QString describe(const int offset) const;
+  private:
+	std::vector<int> line_starts;
+};
+
+
+#endif
@@ -0,0 +1,121 @@
+#include "egix/stream_matcher.hpp"
+
+#include <compsky/regex/named_groups.hpp>
+
+#include <algorithm>
+
+
+constexpr static const size_t max_context = 256; // Characters kept before the search position, for ^, \b and lookbehinds
+
+
+StreamMatcher::StreamMatcher(const std::string& final_regex,  Callback _callback,  const size_t _max_carry)
+: callback(_callback)
+, max_carry(_max_carry)
+, buf_offset(0)
+, search_from(0)
+, after_empty_match(false)
+, n_abandoned_matches(0)
+{
+	std::string s = final_regex;
+	char* const p = &s[0];
+
+	char none[] = "None";
+	char unspecified[] = "Unspecified";
+	std::vector<char*> reason_name2id = {none, unspecified};
+	std::vector<int> groupindx2reason;
+	std::vector<char*> group_starts;
+	std::vector<char*> group_ends;
+	std::vector<bool> record_contents;
+
+	compsky::regex::convert_named_groups(p,  p,  reason_name2id,  groupindx2reason, record_contents, group_starts, group_ends);
+
+	for (const char* const reason : reason_name2id)
+		this->reason_names.emplace_back(reason);
+	for (const int reason : groupindx2reason)
+		this->group2reason.push_back(reason);
+	this->regex.assign(p,  boost::regex::perl);
+}
+
+
+void StreamMatcher::feed(const char* const chunk,  const size_t chunk_sz){
+	this->buf.append(chunk, chunk_sz);
+	this->search(false);
+}
+
+
+void StreamMatcher::finish(){
+	this->search(true);
+	this->buf.clear();
+	this->buf_offset = 0;
+	this->search_from = 0;
+	this->after_empty_match = false;
+}
+
+
+void StreamMatcher::search(const bool at_end){
+	const char* const begin = this->buf.data();
+	const char* const end   = begin + this->buf.size();
+	boost::match_flag_type flags = boost::match_default;
+	if (!at_end)
+		// The end of the buffer is not the end of the stream
+		flags |= boost::match_partial | boost::match_not_eob | boost::match_not_eol;
+	if (this->buf_offset != 0)
+		flags |= boost::match_not_bob;
+
+	// A match is only final once it cannot be affected by more input. Neither a partial match nor a greedy repeat that ran into the end of the buffer is reliably reported as such by boost, so matches starting within max_carry of the end of the buffer are put off until more input arrives.
+	size_t horizon = this->buf.size() + 1;
+	if (!at_end)
+		horizon = (this->buf.size() > this->max_carry) ? this->buf.size() - this->max_carry : 0;
+	size_t keep_from = this->buf.size();
+	bool keep_after_empty_match = false;
+	size_t pos = this->search_from;
+	bool after_empty = this->after_empty_match;
+	while(pos <= this->buf.size()){
+		boost::match_flag_type f = flags;
+		if (pos != 0)
+			f |= boost::match_prev_avail;
+		if (after_empty)
+			// As boost::regex_iterator does: try for a non-empty match at the same position, before moving on
+			f |= boost::match_not_null | boost::match_continuous;
+		boost::match_results<const char*> m;
+		if (!boost::regex_search(begin + pos,  end,  m,  this->regex,  f,  begin)){
+			if (!after_empty)
+				break;
+			after_empty = false;
+			++pos;
+			continue;
+		}
+		const size_t match_start = m[0].first - begin;
+		if (match_start >= horizon){
+			keep_from = std::max(pos, horizon);
+			keep_after_empty_match = (keep_from == pos  &&  after_empty);
+			break;
+		}
+		if (!m[0].matched){
+			// A partial match that has outgrown max_carry. Give up on it, rather than buffer the stream without limit.
+			++this->n_abandoned_matches;
+			pos = match_start + 1;
+			after_empty = false;
+			continue;
+		}
+		for (size_t g = 1;  g < m.size();  ++g){
+			if (!m[g].matched)
+				continue;
+			this->callback({
+				(g < this->group2reason.size()) ? this->group2reason[g] : 0,
+				this->buf_offset + (m[g].first  - begin),
+				this->buf_offset + (m[g].second - begin)
+			});
+		}
+		pos = m[0].second - begin;
+		after_empty = (m[0].first == m[0].second);
+	}
+	if (at_end)
+		return;
+
+	const size_t context = std::min(keep_from, max_context);
+	this->buf.erase(0,  keep_from - context);
+	this->buf_offset += keep_from - context;
+	this->search_from = context;
+	this->after_empty_match = keep_after_empty_match;
+}
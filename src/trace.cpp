@@ -0,0 +1,156 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace trace {
+
+
+struct Event {
+	const char* stage;
+	int64_t start_us;
+	int64_t end_us;
+	size_t thread_id;
+};
+
+struct CounterSample {
+	const char* counter;
+	int64_t at_us;
+	int64_t total;
+};
+
+
+struct StageTotals {
+	size_t calls = 0;
+	int64_t total_us = 0;
+	int64_t max_us = 0;
+};
+
+
+template<typename T>
+class Ring {
+	// The latest max_size items. The live compile records events every few hundred milliseconds for as long as the editor is open, so they cannot all be kept.
+  public:
+	void push(const T& item){
+		if (this->items.size() < max_size){
+			this->items.push_back(item);
+		} else {
+			this->items[this->next] = item;
+			this->next = (this->next + 1) % max_size;
+			++this->n_dropped;
+		}
+	}
+	template<typename F>
+	void for_each(F f) const {
+		// Oldest first
+		for (size_t i = 0;  i < this->items.size();  ++i)
+			f(this->items[(this->next + i) % this->items.size()]);
+	}
+	size_t n_dropped = 0;
+  private:
+	constexpr static const size_t max_size = 1 << 18;
+	std::vector<T> items;
+	size_t next = 0; // Of the oldest item, once full
+};
+
+
+static std::mutex mutex;
+static bool chrome_trace; // Otherwise only the totals are written, so individual events need not be kept
+static Ring<Event> events;
+static Ring<CounterSample> counter_samples;
+static std::map<std::string, StageTotals> stages; // Of every event, including those dropped from events
+static std::map<std::string, int64_t> counters;
+
+
+static
+void write_chrome_trace(FILE* const f){
+	fprintf(f, "{\"traceEvents\":[\n");
+	bool first = true;
+	events.for_each([&](const Event& e){
+		fprintf(f,  "%s{\"name\":\"%s\",\"cat\":\"egix\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%zu}",  (first) ? "" : ",\n",  e.stage,  (long long)e.start_us,  (long long)(e.end_us - e.start_us),  e.thread_id);
+		first = false;
+	});
+	counter_samples.for_each([&](const CounterSample& c){
+		fprintf(f,  "%s{\"name\":\"%s\",\"cat\":\"egix\",\"ph\":\"C\",\"ts\":%lld,\"pid\":1,\"args\":{\"value\":%lld}}",  (first) ? "" : ",\n",  c.counter,  (long long)c.at_us,  (long long)c.total);
+		first = false;
+	});
+	fprintf(f,  "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%zu,\"dropped_counter_samples\":%zu}}\n",  events.n_dropped,  counter_samples.n_dropped);
+}
+
+static
+void write_summary(FILE* const f){
+	fprintf(f, "stage\tcalls\ttotal_ms\tmean_ms\tmax_ms\n");
+	for (const auto& kv : stages)
+		fprintf(f,  "%s\t%zu\t%.3f\t%.3f\t%.3f\n",  kv.first.c_str(),  kv.second.calls,  kv.second.total_us / 1000.0,  kv.second.total_us / 1000.0 / kv.second.calls,  kv.second.max_us / 1000.0);
+	fprintf(f, "\ncounter\ttotal\n");
+	for (const auto& kv : counters)
+		fprintf(f,  "%s\t%lld\n",  kv.first.c_str(),  (long long)kv.second);
+}
+
+static
+void write_on_exit(){
+	const char* const path = getenv("EGIX_TRACE");
+	FILE* const f = fopen(path, "w");
+	if (f == nullptr){
+		fprintf(stderr,  "Cannot write trace to %s\n",  path);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (chrome_trace)
+		write_chrome_trace(f);
+	else
+		write_summary(f);
+	fclose(f);
+}
+
+static
+bool init(){
+	const char* const path = getenv("EGIX_TRACE");
+	if (path == nullptr  ||  path[0] == 0)
+		return false;
+	const size_t len = strlen(path);
+	chrome_trace = (len >= 5  &&  strcmp(path + len - 5,  ".json") == 0);
+	atexit(write_on_exit);
+	return true;
+}
+
+
+const bool enabled = init();
+
+
+int64_t now_us(){
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char* stage,  const int64_t start_us,  const int64_t end_us){
+	const size_t thread_id = std::hash<std::thread::id>()(std::this_thread::get_id()) % 1000000;
+	std::lock_guard<std::mutex> lock(mutex);
+	StageTotals& t = stages[stage];
+	const int64_t us = end_us - start_us;
+	++t.calls;
+	t.total_us += us;
+	if (us > t.max_us)
+		t.max_us = us;
+	if (chrome_trace)
+		events.push({stage,  start_us,  end_us,  thread_id});
+}
+
+void add(const char* counter,  const int64_t n){
+	const int64_t at_us = now_us();
+	std::lock_guard<std::mutex> lock(mutex);
+	const int64_t total = (counters[counter] += n);
+	if (chrome_trace)
+		counter_samples.push({counter,  at_us,  total});
+}
+
+
+}
@@ -0,0 +1,44 @@
+#ifndef EGIX_TRACE_HPP
+#define EGIX_TRACE_HPP
+
+#include <cstdint>
+
+
+namespace trace {
+	/*
+	 * Stage-level timers and counters for the compile pipeline.
+	 * Enabled by setting EGIX_TRACE to an output path: on exit, a Chrome trace-event file is written if the path ends in .json, otherwise a plain summary.
+	 * The summary covers the whole session, but a trace-event file only has room for the latest events, so as not to grow for as long as the editor is open.
+	 * When disabled, each timer or counter costs a single branch.
+	 */
+	
+	extern const bool enabled;
+	
+	int64_t now_us();
+	void record(const char* stage,  const int64_t start_us,  const int64_t end_us);
+	void add(const char* counter,  const int64_t n);
+	
+	class Scope {
+	  public:
+		explicit Scope(const char* _stage) : stage((enabled) ? _stage : nullptr),  start_us((this->stage != nullptr) ? now_us() : 0) {} // A null stage disables the timer, e.g. for recursive calls
+		~Scope(){
+			if (this->stage != nullptr)
+				record(this->stage,  this->start_us,  now_us());
+		}
+	  private:
+		const char* const stage;
+		const int64_t start_us;
+	};
+	
+	inline void count(const char* counter,  const int64_t n = 1){
+		if (enabled)
+			add(counter, n);
+	}
+}
+
+#define EGIX_TRACE_CONCAT2(a, b) a##b
+#define EGIX_TRACE_CONCAT(a, b) EGIX_TRACE_CONCAT2(a, b)
+#define EGIX_TRACE_SCOPE(stage) const trace::Scope EGIX_TRACE_CONCAT(egix_trace_scope_, __LINE__)(stage)
+
+
+#endif
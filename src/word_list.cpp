@@ -0,0 +1,91 @@
+/*
+ * Word lists (one literal word per line) are memory-mapped and streamed straight into a WordTrie, so the words never enter the editor's QTextDocument.
+ * The resulting regexes are cached by the hash of the file's contents: in memory for the session, and on disk across sessions.
+ */
+
+#include "word_list.hpp"
+#include "word_trie.hpp"
+
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring> // for memchr
+
+
+constexpr static const int trie_format_version = 3; // Incremented whenever WordTrie's output changes, so that regexes cached by older versions are not used
+constexpr static const int max_cached_chars = 64 * 1024 * 1024; // Of the regexes cached in memory
+
+
+static
+QString cache_dir(){
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/wordlists/v" + QString::number(trie_format_version);
+}
+
+
+bool word_list_regex(const QString& file_path,  QString& regex,  QString& error){
+	// Hashing a large file on every compile would defeat the cache, so files that are unmodified since they were last hashed are looked up by their metadata alone
+	static QCache<QString, QString> metadata2regex(max_cached_chars); // The least recently used are evicted first
+	
+	const QFileInfo info(file_path);
+	const QString metadata = info.absoluteFilePath() + "\t" + QString::number(info.size()) + "\t" + QString::number(info.lastModified().toMSecsSinceEpoch());
+	{
+		const QString* const cached = metadata2regex.object(metadata);
+		if (cached != nullptr){
+			regex = *cached;
+			return true;
+		}
+	}
+	
+	QFile f(file_path);
+	if (!f.open(QIODevice::ReadOnly)){
+		error = f.errorString();
+		return false;
+	}
+	const qint64 sz = f.size();
+	const char* const data = (sz == 0) ? "" : reinterpret_cast<const char*>(f.map(0, sz));
+	if (data == nullptr){
+		error = f.errorString();
+		return false;
+	}
+	
+	const QByteArray hash = QCryptographicHash::hash(QByteArray::fromRawData(data, sz),  QCryptographicHash::Sha1).toHex();
+	QFile cache_file(cache_dir() + "/" + hash);
+	if (cache_file.open(QIODevice::ReadOnly)){
+		regex = QString::fromUtf8(cache_file.readAll());
+		cache_file.close();
+	} else {
+		WordTrie trie;
+		const char* itr = data;
+		const char* const end = data + sz;
+		while(itr != end){
+			const char* const nl = reinterpret_cast<const char*>(memchr(itr, '\n', end - itr));
+			const char* word_end = (nl == nullptr) ? end : nl;
+			if (word_end != itr  &&  word_end[-1] == '\r')
+				--word_end;
+			if (word_end != itr)
+				trie.insert(itr, word_end);
+			itr = (nl == nullptr) ? end : nl + 1;
+		}
+		const std::string s = (trie.n_words() == 0) ? std::string("(?!)") /* Matches nothing */ : trie.to_regex();
+		regex = QString::fromUtf8(s.data(), s.size());
+		
+		// Written to a temporary file that replaces the cache entry only once complete, as a partially written entry would be read back as a valid but truncated regex
+		QDir().mkpath(cache_dir());
+		QSaveFile new_cache_file(cache_file.fileName());
+		if (new_cache_file.open(QIODevice::WriteOnly)){
+			new_cache_file.write(s.data(), s.size());
+			new_cache_file.commit();
+		}
+	}
+	
+	f.close(); // Also unmaps
+	
+	metadata2regex.insert(metadata,  new QString(regex),  regex.size());
+	return true;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <QString>
+
+
+bool word_list_regex(const QString& file_path,  QString& regex,  QString& error);
@@ -0,0 +1,180 @@
+#include "word_trie.hpp"
+
+#include <algorithm>
+#include <cstring> // for strchr
+
+
+constexpr static const uint32_t invalid_byte = 0x110000; // Added to a byte that is not part of valid UTF-8, so that it is its own unit, distinct from every code point
+
+
+static
+size_t utf8_length(const uint32_t code_point){
+	return (code_point < 0x80) ? 1 : (code_point < 0x800) ? 2 : (code_point < 0x10000) ? 3 : 4;
+}
+
+static
+uint32_t next_unit(const char*& itr,  const char* const end){
+	// Decodes the code point starting at itr. Bytes that are not valid (and shortest-form) UTF-8 are returned one at a time, as invalid_byte + the byte.
+	const unsigned char c = *itr++;
+	if (c < 0x80)
+		return c;
+	size_t n_continuation;
+	uint32_t code_point;
+	if (c >= 0xc2  &&  c < 0xe0){
+		n_continuation = 1;
+		code_point = c & 0x1f;
+	} else if (c >= 0xe0  &&  c < 0xf0){
+		n_continuation = 2;
+		code_point = c & 0x0f;
+	} else if (c >= 0xf0  &&  c < 0xf5){
+		n_continuation = 3;
+		code_point = c & 0x07;
+	} else {
+		return invalid_byte + c;
+	}
+	if ((size_t)(end - itr) < n_continuation)
+		return invalid_byte + c;
+	for (size_t k = 0;  k < n_continuation;  ++k){
+		const unsigned char b = itr[k];
+		if ((b & 0xc0) != 0x80)
+			return invalid_byte + c;
+		code_point = (code_point << 6) | (b & 0x3f);
+	}
+	if (utf8_length(code_point) != n_continuation + 1  ||  code_point > 0x10ffff  ||  (code_point >= 0xd800  &&  code_point < 0xe000))
+		return invalid_byte + c;
+	itr += n_continuation;
+	return code_point;
+}
+
+static
+void append_escaped(std::string& regex,  const unsigned char c,  const bool in_set){
+	if (c == 0){
+		regex += "\\x00"; // Would otherwise terminate the regex
+		return;
+	}
+	const char* const metachars = (in_set) ? "\\]^-[" : "\\^$.|?*+()[]{}";
+	if (strchr(metachars, c) != nullptr)
+		regex += '\\';
+	regex += (char)c;
+}
+
+static
+void append_unit(std::string& regex,  const uint32_t unit){
+	// Outside of a set. A multi-byte code point is a sequence of literal bytes to boost, so cannot go in a set.
+	if (unit < 0x80){
+		append_escaped(regex,  unit,  false);
+	} else if (unit >= invalid_byte){
+		// Escaped, as the regex is decoded as UTF-8 into a QString, which would replace the raw byte with U+FFFD
+		static const char* const hex_digits = "0123456789abcdef";
+		const unsigned char c = unit - invalid_byte;
+		regex += "\\x";
+		regex += hex_digits[c >> 4];
+		regex += hex_digits[c & 0xf];
+	} else if (unit < 0x800){
+		regex += (char)(0xc0 | (unit >> 6));
+		regex += (char)(0x80 | (unit & 0x3f));
+	} else if (unit < 0x10000){
+		regex += (char)(0xe0 | (unit >> 12));
+		regex += (char)(0x80 | ((unit >> 6) & 0x3f));
+		regex += (char)(0x80 | (unit & 0x3f));
+	} else {
+		regex += (char)(0xf0 | (unit >> 18));
+		regex += (char)(0x80 | ((unit >> 12) & 0x3f));
+		regex += (char)(0x80 | ((unit >> 6) & 0x3f));
+		regex += (char)(0x80 | (unit & 0x3f));
+	}
+}
+
+
+WordTrie::WordTrie()
+: nodes(1)
+, n(0)
+{
+	this->nodes[0].terminal = false;
+}
+
+size_t WordTrie::n_words() const {
+	return this->n;
+}
+
+void WordTrie::insert(const char* begin,  const char* end){
+	int node = 0;
+	for (const char* itr = begin;  itr != end;  ){
+		const uint32_t c = next_unit(itr, end);
+		std::vector<std::pair<uint32_t, int>>& children = this->nodes[node].children;
+		auto it = std::lower_bound(
+			children.begin(),
+			children.end(),
+			c,
+			[](const std::pair<uint32_t, int>& child,  const uint32_t ch){
+				return child.first < ch;
+			}
+		);
+		if (it != children.end()  &&  it->first == c){
+			node = it->second;
+			continue;
+		}
+		const int child = this->nodes.size();
+		children.emplace(it,  c,  child); // NOTE: children is invalidated by the following push_back
+		this->nodes.push_back(Node{{}, false});
+		node = child;
+	}
+	if (!this->nodes[node].terminal)
+		++this->n;
+	this->nodes[node].terminal = true;
+}
+
+void WordTrie::to_regex(const int node_indx,  std::string& regex) const {
+	const Node& node = this->nodes[node_indx];
+	
+	// Words that end one (single byte) character after this node are merged into a single set, e.g. (?:a|b|c) -> [abc]
+	std::vector<uint32_t> set;
+	std::vector<int> others;
+	for (const std::pair<uint32_t, int>& child : node.children){
+		const Node& c = this->nodes[child.second];
+		if (c.terminal  &&  c.children.empty()  &&  child.first < 0x80)
+			set.push_back(child.first);
+		else
+			others.push_back(child.second);
+	}
+	
+	const size_t n_alternatives = others.size() + (!set.empty());
+	if (n_alternatives == 0)
+		return;
+	const bool needs_group = (n_alternatives > 1)  ||  (node.terminal  &&  !(others.empty()  &&  !set.empty()));
+	
+	if (needs_group)
+		regex += "(?:";
+	bool first = true;
+	for (const std::pair<uint32_t, int>& child : node.children){
+		if (std::find(others.begin(), others.end(), child.second) == others.end())
+			continue;
+		if (!first)
+			regex += '|';
+		first = false;
+		append_unit(regex,  child.first);
+		this->to_regex(child.second,  regex);
+	}
+	if (!set.empty()){
+		if (!first)
+			regex += '|';
+		if (set.size() == 1){
+			append_unit(regex,  set[0]);
+		} else {
+			regex += '[';
+			for (const uint32_t c : set)
+				append_escaped(regex,  c,  true);
+			regex += ']';
+		}
+	}
+	if (needs_group)
+		regex += ')';
+	if (node.terminal)
+		regex += '?';
+}
+
+std::string WordTrie::to_regex() const {
+	std::string regex;
+	this->to_regex(0, regex);
+	return regex;
+}
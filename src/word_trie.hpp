@@ -0,0 +1,32 @@
+#ifndef EGIX_WORD_TRIE_HPP
+#define EGIX_WORD_TRIE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+class WordTrie {
+	/*
+	 * Compresses a list of literal words into a regex that shares their common prefixes, e.g. {foo, foobar, fox} -> fo(?:o(?:bar)?|x)
+	 * Unlike regopt.pl, this runs in-process and streams the words in, so that it scales to word lists of hundreds of thousands of words.
+	 * Words are UTF-8, and the trie branches on code points rather than bytes, so that the regex never splits a character.
+	 * Bytes that are not valid UTF-8 are matched by \xHH escapes, so that the regex itself is always valid UTF-8.
+	 */
+  public:
+	WordTrie();
+	void insert(const char* begin,  const char* end);
+	std::string to_regex() const;
+	size_t n_words() const;
+  private:
+	struct Node {
+		std::vector<std::pair<uint32_t, int>> children; // Sorted by code point
+		bool terminal;
+	};
+	void to_regex(const int node,  std::string& regex) const;
+	std::vector<Node> nodes;
+	size_t n;
+};
+
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Differential test of the DFA, and of Matcher, against boost: random patterns - including anchors, classes and escapes that the DFA must either implement exactly or refuse - on random inputs.
+ * The DFA is used to skip records that cannot match, so any disagreement silently loses matches.
+ *
+ * Usage: test-dfa [N_PATTERNS]
+ */
+
+#include "egix/dfa.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+
+static
+std::string random_atom(std::mt19937& rng,  const int depth);
+
+
+static
+std::string random_regex(std::mt19937& rng,  const int depth){
+	std::string s;
+	const int n_alternatives = (rng() % 4 == 0) ? 2 : 1;
+	for (auto a = 0;  a < n_alternatives;  ++a){
+		if (a != 0)
+			s += "|";
+		const int n_atoms = 1 + rng() % 4;
+		for (auto k = 0;  k < n_atoms;  ++k){
+			s += random_atom(rng, depth);
+			switch(rng() % 10){
+				case 0: s += "*"; break;
+				case 1: s += "+"; break;
+				case 2: s += "?"; break;
+				case 3: s += "{1,2}"; break;
+				case 4: s += "*?"; break;
+				default: break;
+			}
+		}
+	}
+	return s;
+}
+
+
+static
+std::string random_atom(std::mt19937& rng,  const int depth){
+	static const char* const atoms[] = {
+		"a", "b", "c", ".", "-", "_", " ",
+		"\\d", "\\D", "\\w", "\\W", "\\s", "\\S", "\\n", "\\t", "\\x41", "\\.", "\\-", "\\*",
+		"\\<", "\\>", "\\`", "\\'", "\\b", "\\B", "\\A", "\\z", "\\Z", "^", "$",
+		"[abc]", "[^a]", "[a-c]", "[]a]", "[^]a]", "[a-]", "[\\d_]", "[\\x41-Z]",
+		"[[:alpha:]]", "[[:digit:]]", "[[:space:]]", "[[:punct:]]", "[[:upper:]]", "[[:word:]]",
+		"[[.a.]]", "[[=a=]]", "[[.hyphen.]]", "(?=a)", "(?!a)", "(?<=a)", "(?i)a",
+	};
+	const size_t n = sizeof(atoms) / sizeof(atoms[0]);
+	if (depth < 3  &&  rng() % 6 == 0)
+		return ((rng() % 2) ? "(" : "(?:") + random_regex(rng, depth + 1) + ")";
+	return atoms[rng() % n];
+}
+
+
+static
+std::string random_input(std::mt19937& rng){
+	static const char alphabet[] = {'a', 'b', 'c', 'A', 'Z', '1', ' ', '\t', '\n', '_', '.', '-', '*', (char)0xe9};
+	std::string s;
+	const size_t len = rng() % 10;
+	for (size_t k = 0;  k < len;  ++k)
+		s += alphabet[rng() % sizeof(alphabet)];
+	return s;
+}
+
+
+int main(int argc,  char** argv){
+	const unsigned n_patterns = (argc > 1) ? atoi(argv[1]) : 20000;
+	constexpr static const unsigned n_inputs = 200;
+	std::mt19937 rng(1);
+	unsigned n_compiled = 0;
+	unsigned n_failures = 0;
+	for (unsigned p = 0;  p < n_patterns;  ++p){
+		const std::string regex = random_regex(rng, 0);
+		boost::basic_regex<char, boost::cpp_regex_traits<char>> r;
+		try {
+			r.assign(regex,  boost::regex::perl);
+		} catch (boost::regex_error&){
+			continue;
+		}
+		const Matcher matcher(regex.c_str());
+		if (matcher.dfa != nullptr)
+			++n_compiled;
+		for (unsigned i = 0;  i < n_inputs;  ++i){
+			const std::string input = random_input(rng);
+			bool expected;
+			bool found;
+			try {
+				expected = boost::regex_search(input.data(),  input.data() + input.size(),  r);
+				found = matcher.search(input.data(),  input.data() + input.size());
+			} catch (std::runtime_error&){
+				continue;
+			}
+			if (found == expected)
+				continue;
+			if (n_failures++ < 20)
+				fprintf(stderr,  "Disagreement: /%s/ (%s) on \"%s\": boost %s\n",  regex.c_str(),  (matcher.dfa != nullptr) ? "DFA" : "boost fallback",  input.c_str(),  (expected) ? "matches" : "does not match");
+		}
+	}
+	fprintf(stderr,  "%u of %u patterns compiled to a DFA\n",  n_compiled,  n_patterns);
+	if (n_compiled == 0){
+		fprintf(stderr,  "No pattern compiled to a DFA, so nothing was tested\n");
+		return 1;
+	}
+	if (n_failures != 0)
+		fprintf(stderr,  "%u disagreements\n",  n_failures);
+	return (n_failures == 0) ? 0 : 1;
+}
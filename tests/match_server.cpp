@@ -0,0 +1,192 @@
+/*
+ * Starts egix-server on a temporary socket, and checks the results of list and match requests, that a text too complex to match fails only its own request, and that a malformed request closes only its own connection.
+ *
+ * Usage: test-match-server EGIX_SERVER_PATH
+ */
+
+#include "../src/match_protocol.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+
+static unsigned n_failures = 0;
+
+#define CHECK(cond) \
+	if (!(cond)){ \
+		fprintf(stderr,  "%s:%d: Failed: %s\n",  __FILE__,  __LINE__,  #cond); \
+		++n_failures; \
+	}
+
+
+static
+int connect_to(const std::string& socket_path){
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+		return -1;
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path,  socket_path.c_str(),  sizeof(addr.sun_path) - 1);
+	if (connect(fd,  reinterpret_cast<sockaddr*>(&addr),  sizeof(addr)) != 0){
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+struct Result {
+	uint32_t reason;
+	uint32_t start;
+	uint32_t end;
+};
+
+
+static
+bool request_match(const int fd,  const uint32_t pattern_indx,  const std::vector<std::string>& texts,  uint32_t& status,  std::string& error,  std::vector<std::vector<Result>>& results){
+	std::string request(1, match_protocol::match);
+	match_protocol::append_u32(request, pattern_indx);
+	match_protocol::append_u32(request, texts.size());
+	for (const std::string& text : texts)
+		match_protocol::append_string(request,  text.data(),  text.size());
+	if (!match_protocol::write_all(fd, request.data(), request.size())  ||  !match_protocol::read_u32(fd, status))
+		return false;
+	if (status != match_protocol::ok)
+		return match_protocol::read_string(fd, error);
+	results.assign(texts.size(),  std::vector<Result>());
+	for (std::vector<Result>& text_results : results){
+		uint32_t n;
+		if (!match_protocol::read_u32(fd, n))
+			return false;
+		text_results.resize(n);
+		for (Result& r : text_results)
+			if (!match_protocol::read_u32(fd, r.reason)  ||  !match_protocol::read_u32(fd, r.start)  ||  !match_protocol::read_u32(fd, r.end))
+				return false;
+	}
+	return true;
+}
+
+
+int main(int argc,  char** argv){
+	if (argc != 2){
+		fprintf(stderr,  "Usage: %s EGIX_SERVER_PATH\n",  argv[0]);
+		return 1;
+	}
+
+	char dir[] = "/tmp/egix-test-XXXXXX";
+	if (mkdtemp(dir) == nullptr){
+		perror("mkdtemp");
+		return 1;
+	}
+	const std::string socket_path = std::string(dir) + "/socket";
+	const std::string digits_path = std::string(dir) + "/digits.re";
+	const std::string complex_path = std::string(dir) + "/complex.re";
+	std::ofstream(digits_path) << "(?P<digits>[0-9]+)";
+	std::ofstream(complex_path) << "(?P<complex>(a*)*b)";
+
+	const pid_t server = fork();
+	if (server == 0){
+		execl(argv[1],  argv[1],  socket_path.c_str(),  digits_path.c_str(),  complex_path.c_str(),  (char*)nullptr);
+		perror("execl");
+		_exit(127);
+	}
+
+	int fd = -1;
+	for (unsigned n_tries = 0;  n_tries < 100  &&  fd == -1;  ++n_tries){
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		fd = connect_to(socket_path);
+	}
+	CHECK(fd != -1);
+	if (fd != -1){
+		// List
+		CHECK(match_protocol::write_all(fd, &match_protocol::list_patterns, 1));
+		uint32_t n_patterns = 0;
+		CHECK(match_protocol::read_u32(fd, n_patterns)  &&  n_patterns == 2);
+		std::vector<std::string> digits_reasons;
+		for (uint32_t p = 0;  p < n_patterns;  ++p){
+			std::string name;
+			uint32_t n_reasons = 0;
+			CHECK(match_protocol::read_string(fd, name)  &&  match_protocol::read_u32(fd, n_reasons));
+			std::vector<std::string> reasons(n_reasons);
+			for (std::string& reason : reasons)
+				CHECK(match_protocol::read_string(fd, reason));
+			uint32_t n_groups = 0;
+			CHECK(match_protocol::read_u32(fd, n_groups));
+			for (uint32_t g = 0;  g < n_groups;  ++g){
+				uint32_t reason;
+				CHECK(match_protocol::read_u32(fd, reason));
+			}
+			if (p == 0){
+				CHECK(name == digits_path);
+				digits_reasons = reasons;
+			}
+		}
+
+		// Match
+		uint32_t status = match_protocol::failed;
+		std::string error;
+		std::vector<std::vector<Result>> results;
+		CHECK(request_match(fd,  0,  {"ab12c345", "", "none"},  status,  error,  results));
+		CHECK(status == match_protocol::ok);
+		if (status == match_protocol::ok  &&  results.size() == 3){
+			CHECK(results[0].size() == 2);
+			if (results[0].size() == 2){
+				CHECK(results[0][0].start == 2  &&  results[0][0].end == 4);
+				CHECK(results[0][1].start == 5  &&  results[0][1].end == 8);
+				CHECK(results[0][0].reason < digits_reasons.size()  &&  digits_reasons[results[0][0].reason] == "digits");
+			}
+			CHECK(results[1].empty());
+			CHECK(results[2].empty());
+		}
+
+		// A text too complex to match fails its request, but not the connection or the server
+		CHECK(request_match(fd,  1,  {std::string(30000, 'a')},  status,  error,  results));
+		CHECK(status == match_protocol::failed  &&  !error.empty());
+		CHECK(request_match(fd,  0,  {"7"},  status,  error,  results));
+		CHECK(status == match_protocol::ok  &&  results.size() == 1  &&  results[0].size() == 1);
+		close(fd);
+	}
+
+	// A malformed request closes its connection, without the server allocating for texts that were never sent
+	fd = connect_to(socket_path);
+	CHECK(fd != -1);
+	if (fd != -1){
+		std::string request(1, match_protocol::match);
+		match_protocol::append_u32(request, 0);
+		match_protocol::append_u32(request, 0xffffffff);
+		CHECK(match_protocol::write_all(fd, request.data(), request.size()));
+		uint32_t status;
+		CHECK(!match_protocol::read_u32(fd, status));
+		close(fd);
+	}
+	fd = connect_to(socket_path);
+	CHECK(fd != -1);
+	if (fd != -1){
+		uint32_t status = match_protocol::failed;
+		std::string error;
+		std::vector<std::vector<Result>> results;
+		CHECK(request_match(fd,  0,  {"1"},  status,  error,  results)  &&  status == match_protocol::ok);
+		close(fd);
+	}
+
+	kill(server, SIGTERM);
+	waitpid(server, nullptr, 0);
+	unlink(socket_path.c_str());
+	unlink(digits_path.c_str());
+	unlink(complex_path.c_str());
+	rmdir(dir);
+
+	if (n_failures != 0)
+		fprintf(stderr,  "%u failures\n",  n_failures);
+	return (n_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+/*
+ * Checks the semantics of combining sources into a PatternSet: that their group references are renumbered, and that where their matches overlap only the first source to match is reported, as documented.
+ *
+ * Usage: test-pattern-set
+ */
+
+#include "../src/pattern_set.hpp"
+#include "../src/group_table.hpp"
+
+#include <boost/regex.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+static unsigned n_failures = 0;
+
+#define CHECK(cond) \
+	if (!(cond)){ \
+		fprintf(stderr,  "%s:%d: Failed: %s\n",  __FILE__,  __LINE__,  #cond); \
+		++n_failures; \
+	}
+
+
+static
+bool add(PatternSet& set,  const char* const file_path,  const char* const regex){
+	// Builds the group table that the preprocessor would have, for a regex whose only groups are (?P<name>...) groups
+	const QString s(regex);
+	GroupTable groups;
+	for (int i = s.indexOf("(?P<");  i != -1;  i = s.indexOf("(?P<",  i + 1)){
+		const int name_end = s.indexOf(">",  i);
+		groups.add(groups.intern(s.mid(i + 4,  name_end - (i + 4))),  true,  i,  name_end + 1);
+	}
+	QString error;
+	return set.add(file_path,  s,  groups,  error);
+}
+
+
+static
+std::vector<std::string> all_matches(const PatternSet& set,  const std::string& input){
+	// Each match as "<first matched group>:<matched text>", searching on from the end of each match as a consumer of the set would
+	const QByteArray ba = set.combined_converted.toLocal8Bit();
+	const boost::basic_regex<char, boost::cpp_regex_traits<char>> r(ba.constData(),  boost::regex::perl);
+	std::vector<std::string> matches;
+	boost::match_results<std::string::const_iterator> m;
+	for (auto it = input.cbegin();  boost::regex_search(it,  input.cend(),  m,  r);  it = m[0].second){
+		size_t g = 1;
+		while(g < m.size()  &&  !m[g].matched)
+			++g;
+		matches.push_back(std::to_string(g) + ":" + m[0].str());
+		if (m[0].length() == 0)
+			break;
+	}
+	return matches;
+}
+
+
+int main(){
+	{
+		PatternSet set;
+		CHECK(add(set,  "x",  "(?P<a>x)\\1"));
+		CHECK(add(set,  "y",  "(?P<b>y)\\1"));
+		CHECK(set.combined_converted == QString("(?:(x)\\g{1})|(?:(y)\\g{2})"));
+		CHECK(set.group_reasons.size() == 3);
+		CHECK(set.source_of_group(2) == &set.sources[1]);
+		CHECK(all_matches(set, "xxyy") == std::vector<std::string>({"1:xx",  "2:yy"}));
+	}
+	{
+		// Both match at the same position: the first source wins, though the second matches more
+		PatternSet set;
+		CHECK(add(set,  "short",  "(?P<short>foo)"));
+		CHECK(add(set,  "long",   "(?P<long>foobar)"));
+		CHECK(all_matches(set, "foobar") == std::vector<std::string>({"1:foo"}));
+	}
+	{
+		// Likewise in the other order
+		PatternSet set;
+		CHECK(add(set,  "long",   "(?P<long>foobar)"));
+		CHECK(add(set,  "short",  "(?P<short>foo)"));
+		CHECK(all_matches(set, "foobar") == std::vector<std::string>({"1:foobar"}));
+	}
+	{
+		// The second source's match starts within the first's, so it is never reported, although searched for separately it would be
+		PatternSet set;
+		CHECK(add(set,  "ab",  "(?P<ab>ab)"));
+		CHECK(add(set,  "bc",  "(?P<bc>bc)"));
+		CHECK(all_matches(set, "abc") == std::vector<std::string>({"1:ab"}));
+		CHECK(all_matches(set, "bc")  == std::vector<std::string>({"2:bc"}));
+	}
+
+	if (n_failures != 0)
+		fprintf(stderr,  "%u failures\n",  n_failures);
+	return (n_failures == 0) ? 0 : 1;
+}
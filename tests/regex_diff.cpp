@@ -0,0 +1,95 @@
+/*
+ * Checks that diff_regexes reports regexes that disagree on whether they match, and - which accepting the same strings does not reveal - on the spans of their groups.
+ *
+ * Usage: test-regex-diff
+ */
+
+#include "../src/regex_diff.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+static unsigned n_failures = 0;
+
+#define CHECK(cond) \
+	if (!(cond)){ \
+		fprintf(stderr,  "%s:%d: Failed: %s\n",  __FILE__,  __LINE__,  #cond); \
+		++n_failures; \
+	}
+
+
+static
+RegexDiffResult diff(const char* const a,  const char* const b,  const std::vector<std::string>& strs){
+	const Regex regex_a(a,  boost::regex::perl);
+	const Regex regex_b(b,  boost::regex::perl);
+	std::vector<CorpusRecord> inputs;
+	for (const std::string& s : strs)
+		inputs.push_back({s.data(),  s.data() + s.size()});
+	RegexDiffResult result;
+	diff_regexes(regex_a,  regex_b,  inputs,  result);
+	return result;
+}
+
+
+int main(){
+	const std::vector<std::string> seeds = {"foo", "foobar", "xfoobarx", "ab", "ac", "ba", "abc", "abd"};
+	std::vector<std::string> strs;
+	mutate_strings(seeds,  strs,  1,  16);
+	strs.insert(strs.end(),  seeds.begin(),  seeds.end());
+	
+	{
+		// Mutants are deterministic for a given seed, so that a run can be reproduced
+		std::vector<std::string> again;
+		mutate_strings(seeds,  again,  1,  16);
+		CHECK(again.size() + seeds.size() == strs.size()  &&  std::equal(again.begin(),  again.end(),  strs.begin()));
+	}
+	
+	{
+		const RegexDiffResult r = diff("(a)(b|c)",  "(a)([bc])",  strs);
+		CHECK(r.n_inputs == strs.size());
+		CHECK(r.n_disagreements == 0);
+		CHECK(r.compared_groups);
+	}
+	{
+		const RegexDiffResult r = diff("abc",  "abd",  strs);
+		CHECK(r.n_disagreements != 0);
+		CHECK(r.n_span_disagreements == 0);
+		CHECK(!r.disagreements.empty());
+	}
+	{
+		// Both find a match in the same strings, but leftmost alternation stops at "foo"
+		const RegexDiffResult r = diff("foo|foobar",  "foo(?:bar)?",  strs);
+		CHECK(r.n_disagreements != 0);
+		CHECK(r.n_span_disagreements == r.n_disagreements);
+	}
+	{
+		// Same language, same whole matches, but the groups are swapped
+		const RegexDiffResult r = diff("(a)|(b)",  "(b)|(a)",  strs);
+		CHECK(r.n_disagreements != 0);
+		CHECK(r.n_span_disagreements == r.n_disagreements);
+	}
+	{
+		// Groups cannot be compared by index, so only whole matches are
+		const RegexDiffResult r = diff("(a)(b)",  "(ab)",  strs);
+		CHECK(!r.compared_groups);
+		CHECK(r.n_disagreements == 0);
+	}
+	{
+		// Boost gives up on the nested repeat, which must be counted rather than thrown, so the run finishes
+		const std::vector<std::string> pathological{std::string(30000, 'a'),  "aab"};
+		const RegexDiffResult r = diff("(a*)*b",  "(a*)*b",  pathological);
+		CHECK(r.n_inputs == 2);
+		CHECK(r.n_failures == 1);
+		CHECK(r.n_disagreements == 0);
+		const RegexDiffResult r2 = diff("(a*)*b",  "a*b",  pathological);
+		CHECK(r2.n_failures == 1);
+		CHECK(r2.n_disagreements == 1);
+	}
+	
+	if (n_failures != 0)
+		fprintf(stderr,  "%u failures\n",  n_failures);
+	return (n_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+/*
+ * Checks that StreamMatcher, fed random chunkings of random texts, reports the same matches as one boost::regex_iterator over the whole text, and that it keeps to its max_carry limit.
+ */
+
+#include "egix/stream_matcher.hpp"
+
+#include <compsky/regex/named_groups.hpp>
+
+#include <cstdio>
+#include <random>
+#include <tuple>
+
+
+typedef std::vector<std::tuple<uint32_t, uint64_t, uint64_t>> Matches;
+
+
+static
+Matches match_whole(const char* const pattern,  const std::string& text){
+	std::string s = pattern;
+	char none[] = "None";
+	char unspecified[] = "Unspecified";
+	std::vector<char*> reason_name2id = {none, unspecified};
+	std::vector<int> groupindx2reason;
+	std::vector<char*> group_starts;
+	std::vector<char*> group_ends;
+	std::vector<bool> record_contents;
+	compsky::regex::convert_named_groups(&s[0],  &s[0],  reason_name2id,  groupindx2reason, record_contents, group_starts, group_ends);
+	const boost::basic_regex<char, boost::cpp_regex_traits<char>> r(s.c_str(),  boost::regex::perl);
+
+	Matches matches;
+	typedef boost::regex_iterator<const char*,  char,  boost::cpp_regex_traits<char>> Iterator;
+	const Iterator end;
+	for (Iterator it(text.data(),  text.data() + text.size(),  r);  it != end;  ++it)
+		for (size_t g = 1;  g < it->size();  ++g)
+			if ((*it)[g].matched)
+				matches.emplace_back((g < groupindx2reason.size()) ? groupindx2reason[g] : 0,  (*it)[g].first - text.data(),  (*it)[g].second - text.data());
+	return matches;
+}
+
+
+int main(){
+	// None of these can span more than a line, and lines are kept shorter than max_carry, so chunking must make no difference
+	const char* const patterns[] = {
+		"(?P<a>a[^\\n]*z|b)",
+		"(?P<digits>[0-9]+)",
+		"(?P<foo>foo(?:bar)*)",
+		"(?P<short>ab|abcd)",
+		"(?P<near>a[^\\n]{0,5}b)|(?P<c>c)",
+		"(?P<empty>)|a",
+		"(?<=ab)(?P<behind>c)",
+		"^(?P<line>b+)$",
+		"\\b(?P<word>[a-z]+)\\b",
+	};
+	const char alphabet[] = "abcz0123 foobar\n";
+	const size_t max_carry = 20;
+	std::mt19937 rng(0);
+	unsigned n_failures = 0;
+
+	for (const char* const pattern : patterns){
+		for (unsigned n = 0;  n < 1000;  ++n){
+			std::string text;
+			const size_t text_sz = rng() % 200;
+			for (size_t line_sz = 0;  text.size() < text_sz;  ){
+				const char c = (++line_sz == max_carry - 2) ? '\n' : alphabet[rng() % (sizeof(alphabet) - 1)];
+				if (c == '\n')
+					line_sz = 0;
+				text += c;
+			}
+
+			Matches chunked;
+			StreamMatcher matcher(pattern,  [&](const StreamMatcher::Match& m){ chunked.emplace_back(m.reason, m.start, m.end); },  max_carry);
+			for (size_t i = 0;  i < text.size();  ){
+				const size_t chunk_sz = std::min<size_t>(1 + rng() % 8,  text.size() - i);
+				matcher.feed(text.data() + i,  chunk_sz);
+				i += chunk_sz;
+			}
+			matcher.finish();
+
+			if (chunked != match_whole(pattern, text)){
+				if (n_failures++ < 10)
+					fprintf(stderr,  "Chunked matches differ for %s on: %s\n",  pattern,  text.c_str());
+			}
+		}
+	}
+
+	{
+		// A complete match longer than max_carry is reported in full pieces, rather than dropped
+		uint64_t covered = 0;
+		StreamMatcher matcher("(?P<x>x+)",  [&](const StreamMatcher::Match& m){ if (m.start == covered) covered = m.end; },  50);
+		const std::string text(200, 'x');
+		for (size_t i = 0;  i < text.size();  i += 10)
+			matcher.feed(text.data() + i,  10);
+		matcher.finish();
+		if (covered != text.size()  ||  matcher.n_abandoned() != 0){
+			fprintf(stderr,  "Long complete match: covered %lu of %zu, %lu abandoned\n",  (unsigned long)covered,  text.size(),  (unsigned long)matcher.n_abandoned());
+			++n_failures;
+		}
+	}
+
+	{
+		// A partial match longer than max_carry is abandoned once, and matching resumes after its start
+		Matches matches;
+		StreamMatcher matcher("(?P<az>a[^z]*z)|(?P<b>b)",  [&](const StreamMatcher::Match& m){ matches.emplace_back(m.reason, m.start, m.end); },  50);
+		const std::string text = "a" + std::string(199, 'y') + "b";
+		for (size_t i = 0;  i < text.size();  i += 10)
+			matcher.feed(text.data() + i,  std::min<size_t>(10,  text.size() - i));
+		matcher.finish();
+		if (matcher.n_abandoned() != 1  ||  matches.size() != 1  ||  std::get<1>(matches[0]) != 200){
+			fprintf(stderr,  "Long partial match: %lu abandoned, %zu matches\n",  (unsigned long)matcher.n_abandoned(),  matches.size());
+			++n_failures;
+		}
+	}
+
+	if (n_failures != 0)
+		fprintf(stderr,  "%u failures\n",  n_failures);
+	return (n_failures == 0) ? 0 : 1;
+}